@@ -0,0 +1,20 @@
+// include/BinaryDelta.h
+#ifndef BINARYDELTA_H
+#define BINARYDELTA_H
+
+#include <QByteArray>
+
+// Copy/insert delta between two byte buffers (used for page history).
+// A delta is a list of ops: COPY(offset, length) from the base, or
+// INSERT(length, bytes). Lengths and offsets are stored as varints.
+namespace BinaryDelta
+{
+    // Build a delta that turns 'base' into 'target'
+    QByteArray encode(const QByteArray &base, const QByteArray &target);
+
+    // Rebuild the target from 'base' and a delta made by encode().
+    // Returns false (and leaves 'out' empty) if the delta is corrupt.
+    bool apply(const QByteArray &base, const QByteArray &delta, QByteArray &out);
+}
+
+#endif // BINARYDELTA_H
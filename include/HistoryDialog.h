@@ -0,0 +1,38 @@
+// include/HistoryDialog.h
+#ifndef HISTORYDIALOG_H
+#define HISTORYDIALOG_H
+
+#include <QDialog>
+#include <QString>
+
+class QListWidget;
+class QTextBrowser;
+class QPushButton;
+class PageHistory;
+
+// Lists the saved revisions of one page and shows each one as a line diff
+// against the revision before it. "Restore" closes the dialog with
+// Accepted; the chosen text is then available from restoredText().
+class HistoryDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    HistoryDialog(PageHistory *history, const QString &pageKey, QWidget *parent = nullptr);
+
+    QString restoredText() const { return selectedText; }
+
+private slots:
+    void onRevisionSelected(int row);
+
+private:
+    PageHistory *history;
+    QString pageKey;
+    QString selectedText;
+
+    QListWidget *revisionList;
+    QTextBrowser *diffView;
+    QPushButton *restoreButton;
+};
+
+#endif // HISTORYDIALOG_H
@@ -0,0 +1,46 @@
+// include/LibrarySync.h
+#ifndef LIBRARYSYNC_H
+#define LIBRARYSYNC_H
+
+#include <QString>
+#include <QStringList>
+
+class OpLog;
+class PageHistory;
+
+// Two-way sync between two library folders (e.g. a local one and one on a
+// USB stick or a mounted share). Each side's OpLog version vector says which
+// ops it has; only the missing op records are copied across, then replayed
+// into the receiving side's page history. Running instances of either
+// library are told about the changes through its LibraryWatcher journal.
+// A page edited on both sides gets a line-level three-way merge; if both
+// changed the same lines, the op log's winner stays on top and the page is
+// listed in the result.
+namespace LibrarySync
+{
+    struct Result {
+        bool ok = false;
+        QString error;
+        int opsSent = 0;       // local -> remote
+        int opsReceived = 0;   // remote -> local
+        qint64 bytesSent = 0;
+        qint64 bytesReceived = 0;
+        int opsPending = 0;    // Received but not applicable yet (both sides); retried next sync
+        QStringList mergedPages;   // Edited on both sides; the changes were combined
+        QStringList conflictPages; // Edited on both sides in the same lines; the newer edit is on top
+        qint64 elapsedMs = 0;
+
+        QString summary() const;
+    };
+
+    QString defaultLibraryPath();
+
+    // Logs the latest text of pages the op log does not know about yet
+    // (libraries created before the op log, or saved by an older version).
+    // Pages whose history did not change since the last check are skipped.
+    void recordUnloggedPages(OpLog &log, PageHistory &history);
+
+    Result sync(const QString &localPath, const QString &remotePath);
+}
+
+#endif // LIBRARYSYNC_H
@@ -0,0 +1,52 @@
+// include/LibraryWatcher.h
+#ifndef LIBRARYWATCHER_H
+#define LIBRARYWATCHER_H
+
+#include <QObject>
+#include <QString>
+
+class QFileSystemWatcher;
+
+// Lets several app instances share one library folder.
+// Every instance appends one line per change it makes ("saved page X",
+// "moved page X to Y") to a shared journal file and watches that file with
+// QFileSystemWatcher (inotify on Linux). When it changes, only the new lines
+// are read and turned into signals, so each instance learns exactly which
+// pages to refresh instead of polling or reloading everything.
+// Signals are always delivered from the event loop, never from inside an
+// announce...() call, so receivers are not re-entered mid-operation.
+class LibraryWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LibraryWatcher(const QString &libraryPath, QObject *parent = nullptr);
+
+    void announceSaved(const QString &pageKey);
+    void announceMoved(const QString &oldKey, const QString &newKey);
+    void announceStructureChanged(); // Notebooks/sections/pages added (see OpLog)
+
+    // Read journal lines written since the last look without waiting for the
+    // file watcher; their signals are queued like any others
+    void checkJournal();
+
+signals:
+    void pageSaved(const QString &pageKey);
+    void pageMoved(const QString &oldKey, const QString &newKey);
+    void structureChanged();
+    // The journal was truncated before we read all of it; rescan the library
+    void resyncNeeded();
+
+private slots:
+    void onJournalChanged();
+
+private:
+    void append(const QByteArray &line);
+
+    QString journalPath;
+    QString instanceId;          // Lets us skip our own lines
+    QFileSystemWatcher *watcher;
+    qint64 readOffset = 0;       // Everything before this has been handled
+};
+
+#endif // LIBRARYWATCHER_H
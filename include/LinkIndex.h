@@ -0,0 +1,48 @@
+// include/LinkIndex.h
+#ifndef LINKINDEX_H
+#define LINKINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QPair>
+
+// Graph of [[Page]] links between pages, kept in both directions so that
+// "linked from" lookups never have to scan page bodies.
+// Sources are PageHistory keys; targets are page titles (case-insensitive),
+// written as [[Title]] or [[Title|shown text]]. The index is updated one page
+// at a time as pages are saved, and persisted to a file together with a
+// per-page stamp so pages changed behind its back can be re-read on startup.
+class LinkIndex
+{
+public:
+    explicit LinkIndex(const QString &fileName);
+
+    static QStringList parseLinks(const QString &text); // Link targets in 'text', as written
+    static QString renameLinks(const QString &text, const QString &oldTitle, const QString &newTitle);
+    static QString normalized(const QString &title); // How titles are compared (trimmed, case-folded)
+
+    bool load();
+    bool save();
+    bool isDirty() const { return dirty; }
+
+    // Re-reads the links of one page; 'stamp' identifies the indexed version
+    void updatePage(const QString &key, const QString &text, qint64 stamp);
+    void removePage(const QString &key);
+    void movePages(const QList<QPair<QString, QString>> &moves); // (old key, new key) pairs
+
+    QStringList backlinks(const QString &title) const; // Keys of pages linking to 'title'
+    QStringList pageKeys() const { return stamps.keys(); }
+    qint64 stamp(const QString &key) const { return stamps.value(key, -1); }
+
+private:
+    QString fileName;
+    QHash<QString, QSet<QString>> outgoing; // Source key -> normalized targets
+    QHash<QString, QSet<QString>> incoming; // Normalized target -> source keys
+    QHash<QString, qint64> stamps;          // Source key -> stamp when indexed
+    bool dirty = false;
+};
+
+#endif // LINKINDEX_H
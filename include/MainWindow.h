@@ -4,18 +4,28 @@
 
 #include <QMainWindow>
 #include <QModelIndex>
+#include <QHash>
 #include <QPoint> // Needed for context menu position
 
 // Forward declarations
 class QWidget;
 class QTextEdit;
 class QListView; // Added back for notebookListView
+class QListWidget;
+class QListWidgetItem;
 class QTreeView;
 class QSplitter;
 class QStandardItemModel;
 class QLabel;
 class QToolButton;
 class QAction;
+class QCloseEvent;
+class PageHistory;
+class LinkIndex;
+class TreeFilter;
+class LibraryWatcher;
+class OpLog;
+class QStandardItem;
 // Remove CustomSplitter/Handle forward declarations if not used elsewhere
 
 class MainWindow : public QMainWindow
@@ -23,9 +33,13 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    // An empty libraryPath uses the default library in the app data folder
+    MainWindow(const QString &libraryPath = QString(), QWidget *parent = nullptr);
     ~MainWindow();
 
+protected:
+    void closeEvent(QCloseEvent *event) override; // Saves the open page first
+
 private slots:
     // Slots for handling selections in the new lists
     void onNotebookSelected(const QModelIndex &index);
@@ -45,6 +59,23 @@ private slots:
     void addSectionGroup();
     void addSubpage();
     void promoteSubpage();
+    void renamePage(); // Also rewrites [[links]] to the page
+
+    // Page history
+    void saveCurrentPage(); // Records the editor content as a new revision
+    void showPageHistory();
+
+    // Linked-from panel
+    void onBacklinkActivated(QListWidgetItem *item);
+
+    // Changes made by other app instances on the same library
+    void onExternalPageSaved(const QString &key);
+    void onExternalPageMoved(const QString &oldKey, const QString &newKey);
+    void onExternalResync();
+    void onExternalStructureChanged(); // Notebooks/sections/pages added elsewhere
+
+    // Sync
+    void syncWithLibrary(); // Exchange missing ops with another library folder
 
     // Keep old slots if still relevant
     // void handleNewNote(); // Maybe replaced by addPage/addSubpage
@@ -57,6 +88,20 @@ private:
     // void createToolbars(); // Toolbar might be removed or repurposed
     void createStatusBar();
     void loadInitialData(); // Helper to populate models initially
+    QStringList pagePath(const QModelIndex &pageIndex) const; // notebook, section, page, subpage...
+    void appendStoredPages(const QString &notebook, const QString &section); // Pages that only exist in history
+    bool selectPagePath(const QStringList &path); // Navigate to a page by its history path
+    QStandardItem *pageItemFor(const QStringList &path, bool create); // Page item in the shown section
+    void movePageHistory(const QString &oldKey, const QString &newKey);
+    void applyExternalPageChange(const QString &key);
+    void syncLinkIndex();    // Re-index pages whose history changed since the index was saved
+    void refreshBacklinks(); // Fill backlinkList for the open page
+    int updateLinksAfterRename(const QString &oldKey, const QString &newTitle); // -1: title still in use
+    int savePageText(const QString &key, const QString &text); // New revision + op, index, announce
+    void rekeyUnsavedPages(const QString &oldKey, const QString &newKey);
+    bool keepUnsaved(int saveResult) const; // Should a failed save be retried later?
+    void mergeStructure(); // Add notebooks/sections/pages known from the op log
+    void removeStalePageRows(); // Drop rows of pages that no longer exist anywhere
 
     // --- New UI Structure ---
     // Splitters
@@ -73,6 +118,11 @@ private:
     QListView *notebookListView; // Keep as ListView
     QTreeView *sectionTreeView;  // Changed to QTreeView
     QTreeView *pageTreeView;     // Changed to QTreeView
+    QListWidget *backlinkList;   // "Linked from" panel under the page tree
+
+    // Filter-as-you-type for the trees (driven by the line edits in the panel headers)
+    TreeFilter *sectionFilter;
+    TreeFilter *pageFilter;
 
     // Models (QStandardItemModel supports hierarchy)
     QStandardItemModel *notebookModel;
@@ -83,15 +133,28 @@ private:
     QTextEdit *noteEditor;
     // --- End New UI Structure ---
 
+    // Storage
+    QString libraryPath;       // Root folder for everything saved by the app
+    PageHistory *pageHistory;  // Per-page revision store (libraryPath/history)
+    QString currentPageKey;    // History key of the page shown in noteEditor
+    QHash<QString, QString> unsavedPages; // Page key -> text whose save failed; retried later
+    LinkIndex *linkIndex;      // [[Page]] link graph (libraryPath/links.idx)
+    LibraryWatcher *libraryWatcher; // Shares changes with other instances (libraryPath/changes.log)
+    OpLog *opLog;              // Edit log used to sync with other libraries (libraryPath/oplog)
+
 
     // Actions
     QAction *exitAction;
+    QAction *savePageAction;
+    QAction *pageHistoryAction;
+    QAction *syncLibraryAction;
     // Context Menu Actions
     QAction *addSectionGroupAction;
     QAction *addSectionAction; // Re-use for context menu
     QAction *addPageAction;    // Re-use for context menu
     QAction *addSubpageAction;
     QAction *promoteSubpageAction;
+    QAction *renamePageAction;
     // QAction *deleteItemAction; // Consider adding later
     // QAction *renameItemAction; // Consider adding later
 
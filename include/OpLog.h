@@ -0,0 +1,187 @@
+// include/OpLog.h
+#ifndef OPLOG_H
+#define OPLOG_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QVector>
+#include <QSet>
+
+class QDataStream;
+
+// Log of every structural and text edit made to a library, for syncing.
+// Each library is a replica with its own id. Ops are appended to one file per
+// replica (oplog/<replica>.ops) and numbered 1, 2, 3... within it, so a
+// version vector (replica -> highest seq) says exactly which ops a library
+// has. Two libraries sync by copying the op records the other side lacks.
+// Every op also carries a Lamport clock. Replaying all ops in (lamport,
+// replica, seq) order gives every replica the same structure, and the same
+// winner when a page was edited on both sides (last writer wins, unless sync
+// could merge the two edits; both stay in the page history). A page keeps
+// answering to the keys it had before a move, so ops made without knowing of
+// the move still reach it.
+// The replayed structure is updated op by op and saved with the read position
+// of each file (oplog/state.idx), so opening a library reads only new ops.
+class OpLog
+{
+public:
+    enum OpType : quint8 {
+        AddNotebook = 1,  // key: notebook
+        AddSection,       // key: notebook/section, arg: section group or empty
+        AddSectionGroup,  // key: notebook/group
+        AddPage,          // key: page key
+        AddSubpage,       // key: page key
+        MovePage,         // key: old page key, arg: new page key (promote, rename)
+        EditText          // key: page key; payload: BinaryDelta from the base text
+    };
+
+    // Position of an op in replay order
+    struct Order {
+        quint64 lamport = 0;
+        QString replica;
+        quint64 seq = 0;
+
+        bool operator<(const Order &other) const
+        {
+            if (lamport != other.lamport) return lamport < other.lamport;
+            if (replica != other.replica) return replica < other.replica;
+            return seq < other.seq;
+        }
+    };
+
+    struct Op {
+        QString replica;
+        quint64 seq = 0;
+        quint64 lamport = 0;
+        OpType type = AddPage;
+        QString key;
+        QString arg;
+        quint64 baseHash = 0;   // EditText: PageHistory::contentHash of the base, 0 = empty page
+        quint64 resultHash = 0; // EditText: hash of the text after the edit
+        qint64 offset = 0;      // Record position in the replica file
+        qint64 size = 0;
+
+        QString id() const { return replica + QLatin1Char(':') + QString::number(seq); }
+        Order order() const { return {lamport, replica, seq}; }
+    };
+
+    // The library structure every replica agrees on after replaying all ops.
+    // Kept up to date op by op rather than replayed from scratch; see apply().
+    class Structure {
+    public:
+        QStringList notebooks;                                  // In creation order
+        QHash<QString, QStringList> sectionGroups;              // notebook -> groups
+        QHash<QString, QList<QPair<QString, QString>>> sections; // notebook -> (section, group)
+
+        const QStringList &pageKeys() const { return nodeKeys; } // Current keys of all pages
+        QString finalKey(const QString &key) const;    // Where the page moved away from 'key' is now, or empty
+        QString textTarget(const QString &opId) const; // Current key of the page an EditText op landed on
+        quint64 textWinner(const QString &key) const;  // Hash of the page's winning text, 0 if none
+        bool hasResult(const QString &key, quint64 hash) const; // Any EditText of the page ended with it
+
+    private:
+        friend class OpLog;
+
+        struct Winner {
+            quint64 hash = 0;
+            Order order;
+        };
+
+        void apply(const Op &op);
+        void save(QDataStream &out) const;
+        bool load(QDataStream &in);
+        void ensureNotebook(const QString &notebook);
+        void ensureSection(const QString &notebook, const QString &section, const QString &group);
+        int nodeFor(const QString &key);
+        QString currentKey(const QString &key) const;
+        QString currentChildKey(const QString &key) const;
+
+        // Pages are tracked as nodes so that an edit made before a move still
+        // lands on the page wherever it ended up. Keys a node had before a move
+        // stay as aliases, so ops made without knowing of the move find it too.
+        QStringList nodeKeys;
+        QHash<QString, int> nodeAt;
+        QHash<QString, int> aliases;
+        QHash<int, Winner> winners;
+        QHash<int, QSet<quint64>> results;
+        QHash<QString, int> textNodes; // EditText op id -> node
+        QSet<QString> notebookSet;
+        QHash<QString, QSet<QString>> groupSet;
+        QHash<QString, QSet<QString>> sectionSet;
+    };
+
+    explicit OpLog(const QString &directory);
+
+    QString replicaId() const { return localReplica; }
+    QHash<QString, quint64> versionVector() const;
+    bool findOp(const QString &id, Op &op); // By Op::id()
+    // Could another replica rebuild this text of this page from our ops?
+    bool hasResult(const QString &key, quint64 hash) { return structure().hasResult(key, hash); }
+
+    // History file size of a page when its latest text was last known to be
+    // in the log; lets callers skip re-checking pages that did not change
+    qint64 loggedSize(const QString &key) const { return loggedSizes.value(key, -1); }
+    void setLoggedSize(const QString &key, qint64 size);
+    bool saveLoggedSizes();
+
+    // Snapshot of the structure and of how far each replica file was read, so
+    // the next start only reads ops appended since instead of the whole log
+    bool saveState();
+
+    // Record a local edit. Text edits are stored as a delta against 'previous'
+    // when another replica can rebuild it, otherwise as the full text.
+    bool record(OpType type, const QString &key, const QString &arg = QString());
+    bool recordText(const QString &key, const QString &previous, const QString &text);
+
+    QByteArray payload(const Op &op) const;
+    const Structure &structure(); // Replayed from scratch only after an op arrived out of order
+
+    // Sync support: raw records after 'afterSeq', and appending such records
+    // from another library. appendRaw() returns the ops it added.
+    QByteArray rawOps(const QString &replica, quint64 afterSeq);
+    QList<Op> appendRaw(const QString &replica, const QByteArray &records);
+
+    void refresh(); // Pick up ops appended by other instances sharing the library
+
+private:
+    // What is known about one replica file. Ops covered by the saved state are
+    // not read on startup; they are indexed on demand (full replay, old ops
+    // asked for by id or by a sync).
+    struct ReplicaFile {
+        qint64 headerSize = 0;  // 0 = header not read yet
+        quint64 baseSeq = 0;    // Ops 1..baseSeq are not indexed yet
+        qint64 baseEnd = 0;     // File position right after op baseSeq
+        QVector<Op> ops;        // Ops baseSeq + 1 onwards, in seq order
+
+        quint64 count() const { return baseSeq + quint64(ops.size()); }
+    };
+
+    void replay();
+    bool indexAll(const QString &replica);
+    bool append(Op op, const QByteArray &payload);
+    QString fileNameFor(const QString &replica) const;
+    QString stateFileName() const;
+    bool loadFile(const QString &replica); // Reads records not indexed yet
+    bool loadState();
+    void indexOp(const Op &op);            // Brings the structure up to date with a new op
+    QHash<QString, qint64> readLoggedSizes() const;
+    qint64 knownEnd(const QString &replica) const;
+
+    QString directoryPath;
+    QString localReplica;
+    QHash<QString, ReplicaFile> replicas;
+    QHash<QString, qint64> loggedSizes;     // See loggedSize()
+    QSet<QString> changedSizes;             // Set by us since loading; merged into the file on save
+    quint64 lamportClock = 0;               // Highest lamport seen
+    Structure replayed;                     // All indexed ops applied, when replayValid
+    Order lastApplied;                      // Newest op in 'replayed'
+    Order lastMove;                         // Newest MovePage in 'replayed'
+    bool replayValid = true;                // False once an op arrived that could not be applied in place
+    bool stateDirty = false;                // 'replayed' changed since the state was loaded or saved
+};
+
+#endif // OPLOG_H
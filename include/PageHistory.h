@@ -0,0 +1,112 @@
+// include/PageHistory.h
+#ifndef PAGEHISTORY_H
+#define PAGEHISTORY_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QVector>
+
+// Stores every saved revision of every page.
+// Each page gets one append-only file in the history directory. A revision is
+// either a keyframe (the full text, compressed) or a BinaryDelta against the
+// revision before it. A new keyframe is written once the chain's deltas add
+// up to more bytes than the last keyframe, or once replaying the chain would
+// copy more than kMaxRebuildBytes of page text; so any revision is rebuilt
+// from at most kMaxChainLength deltas, and fewer for big pages.
+// Several app instances may share the directory: writers take a per-page
+// QLockFile, and readers ignore a record that is still being appended.
+class PageHistory
+{
+public:
+    explicit PageHistory(const QString &directory);
+
+    // Pages are identified by their notebook/section/page/subpage... titles
+    static QString keyFor(const QStringList &path);
+    static QStringList pathFor(const QString &key);
+    static QChar keySeparator();
+    // Stable 64-bit hash of a revision's content (FNV-1a over UTF-8)
+    static quint64 contentHash(const QByteArray &utf8);
+
+    QString directory() const { return directoryPath; }
+    QStringList pageKeys() const { return entries.keys(); }
+    bool hasPage(const QString &key) const { return entries.contains(key); }
+    // Size of the page's history file; changes with every saved revision
+    qint64 storedSize(const QString &key) const
+    {
+        auto it = entries.constFind(key);
+        return it == entries.cend() ? -1 : it->fileSize;
+    }
+
+    int revisionCount(const QString &key);
+    QDateTime revisionTime(const QString &key, int revision);
+    QString revisionText(const QString &key, int revision);
+    // Like revisionText(), but tells a failed rebuild (unreadable file, broken
+    // delta chain, checksum mismatch) apart from an empty page
+    bool readRevision(const QString &key, int revision, QString &text);
+    quint64 revisionHash(const QString &key, int revision);
+    int findRevision(const QString &key, quint64 hash); // Newest revision with this content, or -1
+    QString latestText(const QString &key);
+
+    // saveRevision() results other than a revision index
+    enum SaveResult {
+        Unchanged = -1,  // Same text as the latest revision; nothing written
+        SaveFailed = -2, // Locked by another instance, or could not be written
+        PageMoved = -3   // Another instance moved the page away (rename, promote);
+                         // re-key once its move is known and save again
+    };
+
+    // Appends 'text' as a new revision. Returns its index or a SaveResult.
+    int saveRevision(const QString &key, const QString &text);
+
+    // Re-keys a page and all of its subpages (e.g. after promote/rename).
+    // Returns the (old key, new key) pairs that were moved.
+    QList<QPair<QString, QString>> movePages(const QString &oldKey, const QString &newKey);
+
+    // Pick up changes made by other app instances sharing the directory.
+    // refreshPage() re-checks one page (new, appended to, or moved away) and
+    // returns true if it changed; refresh() rescans the whole directory and
+    // returns the keys that changed.
+    bool refreshPage(const QString &key);
+    QStringList refresh();
+
+private:
+    static constexpr int kMaxChainLength = 64;
+    static constexpr qint64 kMaxRebuildBytes = 8 * 1024 * 1024; // Chain length x page size
+
+    struct Revision {
+        qint64 offset = 0;  // Position of the record in the file
+        qint64 size = 0;    // Record size on disk
+        qint64 time = 0;    // msecs since epoch
+        quint64 hash = 0;   // contentHash() of the full text
+        bool keyframe = false;
+    };
+
+    struct Entry {
+        QString fileName;
+        qint64 headerSize = 0;
+        qint64 fileSize = 0;
+        bool loaded = false;      // Revision index read from disk?
+        QVector<Revision> revisions;
+        QByteArray latest;        // Cached UTF-8 text of the last revision
+        bool latestValid = false;
+        int chainLength = 0;      // Deltas since the last keyframe
+        qint64 chainBytes = 0;    // Their total payload size
+        qint64 keyframeBytes = 0; // Payload size of the last keyframe
+    };
+
+    QString fileNameFor(const QString &key) const;
+    bool readHeader(const QString &fileName, QString &key, qint64 &headerSize) const;
+    Entry *loadedEntry(const QString &key);
+    bool loadRevisions(Entry &entry);
+    bool rebuild(Entry &entry, int revision, QByteArray &out);
+
+    QString directoryPath;
+    QHash<QString, Entry> entries;
+};
+
+#endif // PAGEHISTORY_H
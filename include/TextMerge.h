@@ -0,0 +1,18 @@
+// include/TextMerge.h
+#ifndef TEXTMERGE_H
+#define TEXTMERGE_H
+
+#include <QString>
+
+// Line-based three-way merge, for a page edited in two libraries since their
+// last sync. Each side's changes to the common base are found with a line
+// diff; changes to different parts of the page are combined.
+namespace TextMerge
+{
+    // Apply the changes 'ours' and 'theirs' each made to 'base'. Returns false
+    // (and leaves 'out' empty) when both changed the same or neighbouring lines
+    // differently. The result does not depend on which side is 'ours'.
+    bool merge(const QString &base, const QString &ours, const QString &theirs, QString &out);
+}
+
+#endif // TEXTMERGE_H
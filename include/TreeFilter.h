@@ -0,0 +1,60 @@
+// include/TreeFilter.h
+#ifndef TREEFILTER_H
+#define TREEFILTER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QModelIndex>
+
+class QTreeView;
+class QStandardItemModel;
+class QTimer;
+
+// Filter-as-you-type for a QTreeView over a QStandardItemModel.
+// Instead of a proxy model (which re-compares every row per keystroke and
+// loses expansion state) it hides non-matching rows in the view itself.
+// All titles are kept case-folded in one packed array, NUL-separated, and a
+// keystroke is a single SIMD substring scan over that array. Ancestors of
+// matches stay visible, expansion is left alone, and only rows whose
+// visibility actually changes are touched.
+class TreeFilter : public QObject
+{
+    Q_OBJECT
+
+public:
+    TreeFilter(QTreeView *view, QStandardItemModel *model, QObject *parent = nullptr);
+
+    QString pattern() const { return currentPattern; }
+
+    // Finds 'needle' in 'haystack' starting at 'from'; returns its position or -1.
+    // Exposed for reuse; both are UTF-16 code units.
+    static qsizetype find(const ushort *haystack, qsizetype size, qsizetype from,
+                          const ushort *needle, qsizetype needleSize);
+
+public slots:
+    void setPattern(const QString &text);
+
+private slots:
+    void onModelChanged();
+
+private:
+    void rebuild(); // Re-pack titles after the model changed
+    void apply();
+
+    QTreeView *view;
+    QStandardItemModel *model;
+    QTimer *reapplyTimer; // Coalesces bursts of model changes
+
+    QString currentPattern;
+    bool dirty = true;
+
+    // One entry per node, in pre-order (parents before children)
+    QVector<ushort> titles;          // Folded titles, each followed by a 0
+    QVector<qsizetype> starts;       // Offset of each node's title (plus one end sentinel)
+    QVector<int> parents;            // Parent node or -1
+    QVector<QModelIndex> indexes;    // Valid until the next model change (then we rebuild)
+    QVector<bool> hidden;            // What the view currently shows
+};
+
+#endif // TREEFILTER_H
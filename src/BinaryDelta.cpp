@@ -0,0 +1,159 @@
+// src/BinaryDelta.cpp
+#include "BinaryDelta.h"
+
+#include <QHash>
+#include <cstring> // For memcmp/memcpy
+
+namespace {
+
+// Matches shorter than one block are cheaper to store as inserts
+constexpr int kBlockSize = 16;
+constexpr quint32 kHashBase = 257;
+
+void writeVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool readVarint(const char *&pos, const char *end, quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+        const quint8 byte = quint8(*pos++);
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false; // Truncated or overlong
+}
+
+void emitCopy(QByteArray &out, qsizetype offset, qsizetype length)
+{
+    if (length <= 0) return;
+    writeVarint(out, (quint64(length) << 1) | 1);
+    writeVarint(out, quint64(offset));
+}
+
+void emitInsert(QByteArray &out, const char *data, qsizetype length)
+{
+    if (length <= 0) return;
+    writeVarint(out, quint64(length) << 1);
+    out.append(data, length);
+}
+
+// Polynomial hash of one block; rolled forward one byte at a time while scanning
+quint32 blockHash(const char *data)
+{
+    quint32 h = 0;
+    for (int i = 0; i < kBlockSize; ++i)
+        h = h * kHashBase + quint8(data[i]);
+    return h;
+}
+
+} // namespace
+
+QByteArray BinaryDelta::encode(const QByteArray &base, const QByteArray &target)
+{
+    const char *b = base.constData();
+    const char *t = target.constData();
+    const qsizetype n = base.size();
+    const qsizetype m = target.size();
+
+    QByteArray out;
+
+    // Most edits touch one spot: strip the common prefix and suffix first
+    qsizetype prefix = 0;
+    const qsizetype maxCommon = qMin(n, m);
+    while (prefix < maxCommon && b[prefix] == t[prefix])
+        ++prefix;
+    qsizetype suffix = 0;
+    while (suffix < maxCommon - prefix && b[n - 1 - suffix] == t[m - 1 - suffix])
+        ++suffix;
+
+    emitCopy(out, 0, prefix);
+
+    // Index the base in non-overlapping blocks, then look for any of them in
+    // the changed middle of the target (catches moved and duplicated text)
+    const qsizetype midEnd = m - suffix;
+    qsizetype pending = prefix; // Start of bytes not yet emitted
+    if (midEnd - prefix >= kBlockSize && n >= kBlockSize) {
+        QHash<quint32, qsizetype> blocks;
+        blocks.reserve(int(n / kBlockSize));
+        for (qsizetype pos = 0; pos + kBlockSize <= n; pos += kBlockSize)
+            blocks.insert(blockHash(b + pos), pos); // Later blocks win, fine either way
+
+        quint32 topPower = 1; // kHashBase^(kBlockSize-1), to roll the oldest byte out
+        for (int i = 1; i < kBlockSize; ++i)
+            topPower *= kHashBase;
+
+        qsizetype i = prefix;
+        quint32 h = blockHash(t + i);
+        while (i + kBlockSize <= midEnd) {
+            auto it = blocks.constFind(h);
+            if (it != blocks.constEnd() && std::memcmp(b + it.value(), t + i, kBlockSize) == 0) {
+                qsizetype from = it.value();
+                qsizetype start = i;
+                qsizetype length = kBlockSize;
+                // Grow the match in both directions
+                while (start + length < midEnd && from + length < n && b[from + length] == t[start + length])
+                    ++length;
+                while (start > pending && from > 0 && b[from - 1] == t[start - 1]) {
+                    --start;
+                    --from;
+                    ++length;
+                }
+                emitInsert(out, t + pending, start - pending);
+                emitCopy(out, from, length);
+                i = start + length;
+                pending = i;
+                if (i + kBlockSize <= midEnd)
+                    h = blockHash(t + i);
+                continue;
+            }
+            if (i + kBlockSize < midEnd)
+                h = (h - quint8(t[i]) * topPower) * kHashBase + quint8(t[i + kBlockSize]);
+            ++i;
+        }
+    }
+    emitInsert(out, t + pending, midEnd - pending);
+
+    emitCopy(out, n - suffix, suffix);
+    return out;
+}
+
+bool BinaryDelta::apply(const QByteArray &base, const QByteArray &delta, QByteArray &out)
+{
+    out.clear();
+    const char *pos = delta.constData();
+    const char *end = pos + delta.size();
+    const quint64 baseSize = quint64(base.size());
+
+    while (pos < end) {
+        quint64 header = 0;
+        if (!readVarint(pos, end, header)) {
+            out.clear();
+            return false;
+        }
+        const quint64 length = header >> 1;
+        if (header & 1) {
+            quint64 offset = 0;
+            if (!readVarint(pos, end, offset) || offset > baseSize || length > baseSize - offset) {
+                out.clear();
+                return false;
+            }
+            out.append(base.constData() + offset, qsizetype(length));
+        } else {
+            if (length > quint64(end - pos)) {
+                out.clear();
+                return false;
+            }
+            out.append(pos, qsizetype(length));
+            pos += length;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,190 @@
+// src/HistoryDialog.cpp
+#include "HistoryDialog.h"
+#include "PageHistory.h"
+
+#include <QtWidgets>
+#include <vector>
+
+namespace {
+
+// Above this many cells the LCS table is skipped and the changed block is
+// shown as a plain remove + add, which keeps huge rewrites responsive
+constexpr qint64 kMaxDiffCells = 4000000;
+constexpr int kContextLines = 3;
+
+enum class LineOp { Same, Removed, Added };
+
+struct DiffLine {
+    LineOp op;
+    QString text;
+};
+
+// Line diff: trims the common head/tail, then runs an LCS over what is left
+QList<DiffLine> diffLines(const QStringList &before, const QStringList &after)
+{
+    int head = 0;
+    while (head < before.size() && head < after.size() && before[head] == after[head])
+        ++head;
+    int tail = 0;
+    while (tail < before.size() - head && tail < after.size() - head
+           && before[before.size() - 1 - tail] == after[after.size() - 1 - tail])
+        ++tail;
+
+    QList<DiffLine> result;
+    for (int i = 0; i < head; ++i)
+        result.append({LineOp::Same, before[i]});
+
+    const int n = before.size() - head - tail;
+    const int m = after.size() - head - tail;
+    if (qint64(n + 1) * (m + 1) > kMaxDiffCells) {
+        for (int i = 0; i < n; ++i)
+            result.append({LineOp::Removed, before[head + i]});
+        for (int j = 0; j < m; ++j)
+            result.append({LineOp::Added, after[head + j]});
+    } else {
+        // lcs[i][j] = LCS length of before[head+i..] and after[head+j..]
+        std::vector<int> lcs(size_t(n + 1) * (m + 1), 0);
+        auto at = [&](int i, int j) -> int & { return lcs[size_t(i) * (m + 1) + j]; };
+        for (int i = n - 1; i >= 0; --i)
+            for (int j = m - 1; j >= 0; --j)
+                at(i, j) = before[head + i] == after[head + j]
+                    ? at(i + 1, j + 1) + 1
+                    : qMax(at(i + 1, j), at(i, j + 1));
+
+        int i = 0, j = 0;
+        while (i < n && j < m) {
+            if (before[head + i] == after[head + j]) {
+                result.append({LineOp::Same, before[head + i]});
+                ++i; ++j;
+            } else if (at(i + 1, j) >= at(i, j + 1)) {
+                result.append({LineOp::Removed, before[head + i++]});
+            } else {
+                result.append({LineOp::Added, after[head + j++]});
+            }
+        }
+        while (i < n) result.append({LineOp::Removed, before[head + i++]});
+        while (j < m) result.append({LineOp::Added, after[head + j++]});
+    }
+
+    for (int i = before.size() - tail; i < before.size(); ++i)
+        result.append({LineOp::Same, before[i]});
+    return result;
+}
+
+// Renders the diff as HTML, folding long unchanged runs down to some context
+QString diffToHtml(const QList<DiffLine> &lines)
+{
+    QString html = "<pre style=\"margin:0\">";
+    int lastShown = -1;
+    for (int i = 0; i < lines.size(); ++i) {
+        bool nearChange = false;
+        for (int k = qMax(0, i - kContextLines); k <= qMin(int(lines.size()) - 1, i + kContextLines); ++k) {
+            if (lines[k].op != LineOp::Same) {
+                nearChange = true;
+                break;
+            }
+        }
+        if (!nearChange)
+            continue;
+        if (i > lastShown + 1)
+            html += "<span style=\"color:#6e7378\">...</span>\n";
+        lastShown = i;
+
+        const QString text = lines[i].text.toHtmlEscaped();
+        switch (lines[i].op) {
+        case LineOp::Removed:
+            html += "<span style=\"background-color:#4b1e22; color:#f1a7ab\">- " + text + "</span>\n";
+            break;
+        case LineOp::Added:
+            html += "<span style=\"background-color:#1e4126; color:#a7f1b5\">+ " + text + "</span>\n";
+            break;
+        case LineOp::Same:
+            html += "  " + text + "\n";
+            break;
+        }
+    }
+    if (lastShown == -1)
+        html += QObject::tr("(no changes)");
+    html += "</pre>";
+    return html;
+}
+
+} // namespace
+
+HistoryDialog::HistoryDialog(PageHistory *history, const QString &pageKey, QWidget *parent)
+    : QDialog(parent), history(history), pageKey(pageKey)
+{
+    setWindowTitle(tr("History of '%1'").arg(PageHistory::pathFor(pageKey).last()));
+    resize(800, 500);
+
+    revisionList = new QListWidget();
+    revisionList->setObjectName("revisionList");
+    diffView = new QTextBrowser();
+    diffView->setObjectName("diffView");
+
+    QSplitter *splitter = new QSplitter(Qt::Horizontal);
+    splitter->addWidget(revisionList);
+    splitter->addWidget(diffView);
+    splitter->setStretchFactor(0, 0);
+    splitter->setStretchFactor(1, 1);
+    splitter->setSizes({200, 600});
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close);
+    restoreButton = buttons->addButton(tr("Restore"), QDialogButtonBox::AcceptRole);
+    restoreButton->setEnabled(false);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(splitter);
+    layout->addWidget(buttons);
+
+    // Newest revision first
+    const int count = history->revisionCount(pageKey);
+    for (int revision = count - 1; revision >= 0; --revision) {
+        QListWidgetItem *item = new QListWidgetItem(
+            tr("#%1  %2").arg(revision + 1)
+                .arg(QLocale().toString(history->revisionTime(pageKey, revision), QLocale::ShortFormat)));
+        item->setData(Qt::UserRole, revision);
+        revisionList->addItem(item);
+    }
+
+    connect(revisionList, &QListWidget::currentRowChanged, this, &HistoryDialog::onRevisionSelected);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    if (count > 0)
+        revisionList->setCurrentRow(0);
+}
+
+void HistoryDialog::onRevisionSelected(int row)
+{
+    QListWidgetItem *item = revisionList->item(row);
+    if (!item) {
+        selectedText.clear();
+        diffView->clear();
+        restoreButton->setEnabled(false);
+        return;
+    }
+
+    const int revision = item->data(Qt::UserRole).toInt();
+    if (!history->readRevision(pageKey, revision, selectedText)) {
+        // Damaged chain: show why instead of an empty page that could be restored
+        diffView->setHtml(QStringLiteral("<p style=\"color:#f1a7ab\">%1</p>")
+                              .arg(tr("Revision #%1 could not be read; the history file may be damaged.")
+                                       .arg(revision + 1).toHtmlEscaped()));
+        restoreButton->setEnabled(false);
+        return;
+    }
+    QString previousText; // The first revision shows up as all additions
+    const bool hasPrevious = revision > 0 && history->readRevision(pageKey, revision - 1, previousText);
+    const QStringList previous = hasPrevious ? previousText.split('\n') : QStringList();
+
+    QString html = diffToHtml(diffLines(previous, selectedText.split('\n')));
+    if (revision > 0 && !hasPrevious) {
+        html.prepend(QStringLiteral("<p style=\"color:#f1a7ab\">%1</p>")
+                         .arg(tr("Revision #%1 could not be read; showing this revision in full.")
+                                  .arg(revision).toHtmlEscaped()));
+    }
+    diffView->setHtml(html);
+    // Restoring the newest revision would be a no-op
+    restoreButton->setEnabled(revision < revisionList->count() - 1);
+}
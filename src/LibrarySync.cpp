@@ -0,0 +1,353 @@
+// src/LibrarySync.cpp
+#include "LibrarySync.h"
+#include "OpLog.h"
+#include "PageHistory.h"
+#include "BinaryDelta.h"
+#include "LibraryWatcher.h"
+#include "TextMerge.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+#include <QSet>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// Everything sync needs from one library folder
+struct Side {
+    explicit Side(const QString &path)
+        : path(path), log(QDir(path).filePath("oplog")), history(QDir(path).filePath("history")) {}
+
+    QString path;
+    OpLog log;
+    PageHistory history;
+};
+
+// Copy the op records 'to' is missing from 'from'; returns the ops added to 'to'
+QList<OpLog::Op> transfer(Side &from, Side &to, qint64 &bytes)
+{
+    QList<OpLog::Op> added;
+    const QHash<QString, quint64> have = to.log.versionVector();
+    const QHash<QString, quint64> offer = from.log.versionVector();
+    for (auto it = offer.cbegin(); it != offer.cend(); ++it) {
+        const quint64 known = have.value(it.key());
+        if (it.value() <= known)
+            continue;
+        const QByteArray records = from.log.rawOps(it.key(), known);
+        bytes += records.size();
+        added += to.log.appendRaw(it.key(), records);
+    }
+    return added;
+}
+
+// Text of 'key' with content 'hash' from its history, or from texts rebuilt during this sync
+bool findText(PageHistory &history, const QHash<quint64, QByteArray> &rebuilt,
+              const QString &key, quint64 hash, QByteArray &out)
+{
+    if (hash == 0) {
+        out.clear();
+        return true;
+    }
+    const int revision = history.findRevision(key, hash);
+    QString text;
+    if (revision >= 0 && history.readRevision(key, revision, text)) {
+        out = text.toUtf8();
+        return true;
+    }
+    auto it = rebuilt.constFind(hash);
+    if (it == rebuilt.cend())
+        return false;
+    out = it.value();
+    return true;
+}
+
+// Received ops that could not be applied to the history yet (e.g. their base
+// text had not arrived); kept by id in the library and retried on every sync
+QString pendingFileName(const Side &side)
+{
+    return QDir(side.path).filePath("oplog/pending.ids");
+}
+
+QList<OpLog::Op> loadPending(Side &side)
+{
+    QList<OpLog::Op> pending;
+    QFile file(pendingFileName(side));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return pending;
+    const QList<QByteArray> ids = file.readAll().split('\n');
+    for (const QByteArray &id : ids) {
+        OpLog::Op op;
+        if (!id.isEmpty() && side.log.findOp(QString::fromLatin1(id), op))
+            pending.append(op);
+    }
+    return pending;
+}
+
+void savePending(const Side &side, const QList<OpLog::Op> &pending)
+{
+    if (pending.isEmpty()) {
+        QFile::remove(pendingFileName(side));
+        return;
+    }
+    QSaveFile file(pendingFileName(side));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return;
+    for (const OpLog::Op &op : pending)
+        file.write(op.id().toLatin1() + '\n');
+    if (!file.commit())
+        qWarning() << "Could not save pending ops" << file.fileName();
+}
+
+// Tell running instances about moved pages, one announcement per moved
+// subtree: parents first, and subpages that simply went along are left out,
+// so every instance moves each row once and never sees a child before its parent
+void announceMoves(LibraryWatcher &watcher, QList<QPair<QString, QString>> moves)
+{
+    std::stable_sort(moves.begin(), moves.end(), [](const QPair<QString, QString> &a, const QPair<QString, QString> &b) {
+        return PageHistory::pathFor(a.first).size() < PageHistory::pathFor(b.first).size();
+    });
+    QList<QPair<QString, QString>> announced;
+    for (const auto &move : std::as_const(moves)) {
+        const bool implied = std::any_of(announced.cbegin(), announced.cend(), [&](const QPair<QString, QString> &done) {
+            if (move.first == done.first)
+                return true;
+            return move.first.startsWith(done.first + PageHistory::keySeparator())
+                && move.second == done.second + move.first.mid(done.first.size());
+        });
+        if (implied)
+            continue;
+        announced.append(move);
+        watcher.announceMoved(move.first, move.second);
+    }
+}
+
+// What the received edits did to one page, to tell whether it was also
+// edited here since the last sync
+struct PageEdits {
+    quint64 localHead = 0;    // Latest text before the first received edit
+    quint64 forkBase = 0;     // Base of the first received edit
+    quint64 incomingHead = 0; // Result of the last received edit
+    QSet<quint64> bases;      // Bases of all received edits
+};
+
+void addPage(QStringList &pages, const QString &key)
+{
+    const QString page = PageHistory::pathFor(key).join(QStringLiteral(" / "));
+    if (!pages.contains(page))
+        pages.append(page);
+}
+
+// Bring this side's page history in line with the replayed op log: move
+// history files to the pages' final keys, then apply received text edits.
+// Ops left pending and pages edited on both sides are added to 'result'.
+void applyOps(Side &side, const QList<OpLog::Op> &received, LibrarySync::Result &result)
+{
+    QList<OpLog::Op> ops = loadPending(side) + received;
+    std::sort(ops.begin(), ops.end(), [](const OpLog::Op &a, const OpLog::Op &b) {
+        if (a.lamport != b.lamport) return a.lamport < b.lamport;
+        if (a.replica != b.replica) return a.replica < b.replica;
+        return a.seq < b.seq;
+    });
+
+    LibraryWatcher watcher(side.path);
+    const OpLog::Structure &structure = side.log.structure();
+
+    // Moves come from the replayed structure, not from the ops as they arrive,
+    // so every replica ends with the same keys. Deepest pages first: a subpage
+    // that moved on its own goes before its old parent would take it along.
+    QStringList keys = side.history.pageKeys();
+    std::sort(keys.begin(), keys.end(), [](const QString &a, const QString &b) {
+        return PageHistory::pathFor(a).size() > PageHistory::pathFor(b).size();
+    });
+    QList<QPair<QString, QString>> moves;
+    for (const QString &key : std::as_const(keys)) {
+        const QString target = structure.finalKey(key);
+        if (target.isEmpty() || !side.history.hasPage(key) || side.history.hasPage(target))
+            continue;
+        if (!side.history.movePages(key, target).isEmpty())
+            moves.append({key, target});
+    }
+    // Received moves of pages without history still move rows in running instances
+    for (const OpLog::Op &op : received) {
+        const QString target = structure.finalKey(op.key);
+        if (op.type == OpLog::MovePage && !target.isEmpty())
+            moves.append({op.key, target});
+    }
+    announceMoves(watcher, moves);
+
+    QHash<quint64, QByteArray> rebuilt;
+    QHash<QString, PageEdits> edits;
+    QList<OpLog::Op> pending;
+    for (const OpLog::Op &op : std::as_const(ops)) {
+        if (op.type != OpLog::EditText)
+            continue;
+        const QString target = structure.textTarget(op.id());
+        const QString key = target.isEmpty() ? op.key : target;
+        QByteArray base;
+        QByteArray text;
+        if (!findText(side.history, rebuilt, key, op.baseHash, base)) {
+            pending.append(op); // Its base may come with a later sync
+            continue;
+        }
+        if (!BinaryDelta::apply(base, side.log.payload(op), text)
+            || PageHistory::contentHash(text) != op.resultHash) {
+            qWarning() << "Could not rebuild" << PageHistory::pathFor(key) << "from op" << op.id();
+            pending.append(op);
+            continue;
+        }
+        rebuilt.insert(op.resultHash, text);
+        const int count = side.history.revisionCount(key);
+        const quint64 head = count > 0 ? side.history.revisionHash(key, count - 1) : 0;
+        const int revision = side.history.saveRevision(key, QString::fromUtf8(text));
+        if (revision == PageHistory::SaveFailed || revision == PageHistory::PageMoved) {
+            pending.append(op);
+            continue;
+        }
+        auto page = edits.find(key);
+        if (page == edits.end()) {
+            page = edits.insert(key, PageEdits());
+            page->localHead = head;
+            page->forkBase = op.baseHash;
+        }
+        page->bases.insert(op.baseHash);
+        page->incomingHead = op.resultHash;
+    }
+
+    for (auto it = edits.cbegin(); it != edits.cend(); ++it) {
+        const QString &key = it.key();
+        const PageEdits &page = it.value();
+
+        // Every replica ends with the same winner on top; other texts stay in the page history
+        const quint64 winner = structure.textWinner(key);
+        const int count = side.history.revisionCount(key);
+        if (winner != 0 && count > 0 && side.history.revisionHash(key, count - 1) != winner) {
+            QByteArray text;
+            if (findText(side.history, rebuilt, key, winner, text))
+                side.history.saveRevision(key, QString::fromUtf8(text));
+        }
+
+        // Edited here too, not on top of the received edits: combine both texts
+        // when they changed different lines. Both replicas get the same merge
+        // and log it, so it also becomes the winner.
+        const bool editedHere = page.localHead != 0 && page.localHead != page.incomingHead
+            && !page.bases.contains(page.localHead);
+        if (editedHere) {
+            QByteArray base;
+            QByteArray ours;
+            QByteArray theirs;
+            QString merged;
+            if (findText(side.history, rebuilt, key, page.forkBase, base)
+                && findText(side.history, rebuilt, key, page.localHead, ours)
+                && findText(side.history, rebuilt, key, page.incomingHead, theirs)
+                && TextMerge::merge(QString::fromUtf8(base), QString::fromUtf8(ours),
+                                    QString::fromUtf8(theirs), merged)) {
+                const QString previous = side.history.latestText(key);
+                if (side.history.saveRevision(key, merged) >= 0)
+                    side.log.recordText(key, previous, merged);
+                addPage(result.mergedPages, key);
+            } else {
+                addPage(result.conflictPages, key);
+            }
+        }
+        side.log.setLoggedSize(key, side.history.storedSize(key)); // All of it is in the log
+        watcher.announceSaved(key);
+    }
+    side.log.saveLoggedSizes();
+
+    const bool structureChanged = std::any_of(received.cbegin(), received.cend(), [](const OpLog::Op &op) {
+        return op.type != OpLog::EditText;
+    });
+    if (structureChanged)
+        watcher.announceStructureChanged();
+
+    savePending(side, pending);
+    result.opsPending += pending.size();
+}
+
+} // namespace
+
+namespace LibrarySync
+{
+
+QString Result::summary() const
+{
+    if (!ok)
+        return QStringLiteral("Sync failed: %1").arg(error);
+    QString text = QStringLiteral("Sync done in %1 ms: sent %2 ops (%3 bytes), received %4 ops (%5 bytes)")
+        .arg(elapsedMs).arg(opsSent).arg(bytesSent).arg(opsReceived).arg(bytesReceived);
+    if (opsPending > 0)
+        text += QStringLiteral(", %1 ops waiting for a later sync").arg(opsPending);
+    if (!mergedPages.isEmpty())
+        text += QStringLiteral(", combined edits from both sides in %1 page(s)").arg(mergedPages.size());
+    if (!conflictPages.isEmpty()) {
+        text += QStringLiteral(". Edited on both sides in the same place (the newer text is on top, "
+                               "the other one is in the page history): %1").arg(conflictPages.join(QStringLiteral(", ")));
+    }
+    return text;
+}
+
+QString defaultLibraryPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/library";
+}
+
+void recordUnloggedPages(OpLog &log, PageHistory &history)
+{
+    // Only pages whose file changed since they were last checked are read
+    const QStringList keys = history.pageKeys();
+    for (const QString &key : keys) {
+        const qint64 size = history.storedSize(key);
+        if (size == log.loggedSize(key) || PageHistory::pathFor(key).size() < 3)
+            continue;
+        const int count = history.revisionCount(key);
+        if (count > 0 && !log.hasResult(key, history.revisionHash(key, count - 1)))
+            log.recordText(key, QString(), history.latestText(key));
+        log.setLoggedSize(key, size);
+    }
+    log.saveLoggedSizes();
+}
+
+Result sync(const QString &localPath, const QString &remotePath)
+{
+    Result result;
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!QFileInfo(remotePath).isDir()) {
+        result.error = QStringLiteral("%1 is not a folder").arg(remotePath);
+        return result;
+    }
+    if (QFileInfo(localPath).canonicalFilePath() == QFileInfo(remotePath).canonicalFilePath()) {
+        result.error = QStringLiteral("both paths are the same library");
+        return result;
+    }
+
+    Side local(localPath);
+    Side remote(remotePath);
+    if (local.log.replicaId() == remote.log.replicaId()) {
+        result.error = QStringLiteral("%1 is a copy of this library").arg(remotePath);
+        return result;
+    }
+    recordUnloggedPages(local.log, local.history);
+    recordUnloggedPages(remote.log, remote.history);
+
+    const QList<OpLog::Op> received = transfer(remote, local, result.bytesReceived);
+    const QList<OpLog::Op> sent = transfer(local, remote, result.bytesSent);
+    result.opsReceived = received.size();
+    result.opsSent = sent.size();
+
+    applyOps(local, received, result);
+    applyOps(remote, sent, result);
+    local.log.saveState(); // Next time, both sides start from here instead of re-reading their logs
+    remote.log.saveState();
+
+    result.ok = true;
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+} // namespace LibrarySync
@@ -0,0 +1,118 @@
+// src/LibraryWatcher.cpp
+#include "LibraryWatcher.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QLockFile>
+#include <QUuid>
+#include <QDebug>
+
+namespace {
+
+// The journal only has to outlive the time other instances need to read it;
+// past this size the next writer starts it over
+constexpr qint64 kMaxJournalSize = 1 << 20;
+constexpr int kLockTimeoutMs = 2000;
+
+} // namespace
+
+LibraryWatcher::LibraryWatcher(const QString &libraryPath, QObject *parent)
+    : QObject(parent),
+      journalPath(QDir(libraryPath).filePath("changes.log")),
+      instanceId(QUuid::createUuid().toString(QUuid::WithoutBraces))
+{
+    QDir().mkpath(libraryPath);
+    QFile journal(journalPath);
+    if (journal.open(QIODevice::Append))
+        readOffset = journal.size(); // Older changes are already on disk for us
+
+    watcher = new QFileSystemWatcher(this);
+    watcher->addPath(journalPath);
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, &LibraryWatcher::onJournalChanged);
+}
+
+void LibraryWatcher::announceSaved(const QString &pageKey)
+{
+    append(instanceId.toUtf8() + "\tsaved\t" + pageKey.toUtf8().toPercentEncoding() + "\n");
+}
+
+void LibraryWatcher::announceMoved(const QString &oldKey, const QString &newKey)
+{
+    append(instanceId.toUtf8() + "\tmoved\t" + oldKey.toUtf8().toPercentEncoding()
+           + "\t" + newKey.toUtf8().toPercentEncoding() + "\n");
+}
+
+void LibraryWatcher::announceStructureChanged()
+{
+    append(instanceId.toUtf8() + "\tstructure\t\n");
+}
+
+void LibraryWatcher::append(const QByteArray &line)
+{
+    QLockFile lock(journalPath + ".lock");
+    if (!lock.tryLock(kLockTimeoutMs)) {
+        qWarning() << "Could not lock" << journalPath << "- other instances will not see this change";
+        return;
+    }
+
+    QFile journal(journalPath);
+    if (!journal.open(QIODevice::ReadWrite)) {
+        qWarning() << "Could not open" << journalPath << journal.errorString();
+        return;
+    }
+    if (journal.size() > kMaxJournalSize) {
+        checkJournal(); // Handle what others wrote before it is gone
+        journal.resize(0);
+        readOffset = 0;
+    }
+    journal.seek(journal.size());
+    journal.write(line);
+}
+
+void LibraryWatcher::onJournalChanged()
+{
+    // Some editors/tools replace files instead of writing them; watch the new one
+    if (!watcher->files().contains(journalPath) && QFile::exists(journalPath))
+        watcher->addPath(journalPath);
+    checkJournal();
+}
+
+void LibraryWatcher::checkJournal()
+{
+    QFile journal(journalPath);
+    if (!journal.open(QIODevice::ReadOnly))
+        return;
+    if (journal.size() < readOffset) {
+        // Started over by another instance; lines we never read are lost
+        readOffset = 0;
+        QMetaObject::invokeMethod(this, &LibraryWatcher::resyncNeeded, Qt::QueuedConnection);
+    }
+    if (!journal.seek(readOffset))
+        return;
+
+    // Only whole lines; a partial one is picked up with the next notification
+    const QByteArray data = journal.readAll();
+    const qsizetype end = data.lastIndexOf('\n');
+    if (end < 0)
+        return;
+    readOffset += end + 1;
+
+    const QList<QByteArray> lines = data.left(end).split('\n');
+    for (const QByteArray &line : lines) {
+        const QList<QByteArray> fields = line.split('\t');
+        if (fields.size() < 3 || fields[0] == instanceId.toUtf8())
+            continue;
+        // Queued: append() reads the journal while its caller is in the middle of a change
+        const QString key = QString::fromUtf8(QByteArray::fromPercentEncoding(fields[2]));
+        if (fields[1] == "saved") {
+            QMetaObject::invokeMethod(this, [this, key] { emit pageSaved(key); }, Qt::QueuedConnection);
+        } else if (fields[1] == "moved" && fields.size() >= 4) {
+            const QString newKey = QString::fromUtf8(QByteArray::fromPercentEncoding(fields[3]));
+            QMetaObject::invokeMethod(this, [this, key, newKey] { emit pageMoved(key, newKey); },
+                                      Qt::QueuedConnection);
+        } else if (fields[1] == "structure") {
+            QMetaObject::invokeMethod(this, &LibraryWatcher::structureChanged, Qt::QueuedConnection);
+        }
+    }
+}
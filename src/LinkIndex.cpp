@@ -0,0 +1,185 @@
+// src/LinkIndex.cpp
+#include "LinkIndex.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QRegularExpression>
+#include <QDebug>
+
+namespace {
+
+constexpr quint32 kIndexMagic = 0x4e4c4931; // "NLI1"
+constexpr quint16 kIndexVersion = 1;
+
+// [[Title]] or [[Title|shown text]]; no brackets or line breaks inside
+const QRegularExpression &linkPattern()
+{
+    static const QRegularExpression pattern(QStringLiteral("\\[\\[([^\\[\\]\\n|]+)(\\|[^\\[\\]\\n]*)?\\]\\]"));
+    return pattern;
+}
+
+} // namespace
+
+LinkIndex::LinkIndex(const QString &fileName)
+    : fileName(fileName)
+{
+}
+
+QString LinkIndex::normalized(const QString &title)
+{
+    return title.trimmed().toCaseFolded();
+}
+
+QStringList LinkIndex::parseLinks(const QString &text)
+{
+    QStringList targets;
+    // Cheap early out: most saves of most pages contain no links at all
+    if (!text.contains(QLatin1String("[[")))
+        return targets;
+
+    QRegularExpressionMatchIterator it = linkPattern().globalMatch(text);
+    while (it.hasNext()) {
+        const QString target = it.next().captured(1).trimmed();
+        if (!target.isEmpty())
+            targets.append(target);
+    }
+    return targets;
+}
+
+QString LinkIndex::renameLinks(const QString &text, const QString &oldTitle, const QString &newTitle)
+{
+    const QString oldTarget = normalized(oldTitle);
+    QString result;
+    qsizetype copied = 0;
+
+    QRegularExpressionMatchIterator it = linkPattern().globalMatch(text);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        if (normalized(match.captured(1)) != oldTarget)
+            continue;
+        // Keep any "|shown text" part as the user wrote it
+        result += QStringView(text).mid(copied, match.capturedStart(1) - copied);
+        result += newTitle;
+        copied = match.capturedEnd(1);
+    }
+    if (copied == 0)
+        return text;
+    result += QStringView(text).mid(copied);
+    return result;
+}
+
+bool LinkIndex::load()
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    QHash<QString, qint64> loadedStamps;
+    QHash<QString, QSet<QString>> loadedOutgoing;
+    in >> magic >> version >> loadedStamps >> loadedOutgoing;
+    if (in.status() != QDataStream::Ok || magic != kIndexMagic || version != kIndexVersion) {
+        qWarning() << "Ignoring unreadable link index" << fileName;
+        return false;
+    }
+
+    stamps = loadedStamps;
+    outgoing = loadedOutgoing;
+    incoming.clear();
+    for (auto it = outgoing.cbegin(); it != outgoing.cend(); ++it) {
+        for (const QString &target : it.value())
+            incoming[target].insert(it.key());
+    }
+    dirty = false;
+    return true;
+}
+
+bool LinkIndex::save()
+{
+    QSaveFile file(fileName); // Replaced atomically, never half-written
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kIndexMagic << kIndexVersion << stamps << outgoing;
+    if (out.status() != QDataStream::Ok || !file.commit())
+        return false;
+    dirty = false;
+    return true;
+}
+
+void LinkIndex::updatePage(const QString &key, const QString &text, qint64 stamp)
+{
+    QSet<QString> targets;
+    for (const QString &target : parseLinks(text))
+        targets.insert(normalized(target));
+
+    // Only touch the reverse entries that actually changed
+    QSet<QString> &current = outgoing[key];
+    for (const QString &target : current) {
+        if (targets.contains(target))
+            continue;
+        auto it = incoming.find(target);
+        if (it != incoming.end()) {
+            it->remove(key);
+            if (it->isEmpty())
+                incoming.erase(it);
+        }
+    }
+    for (const QString &target : targets) {
+        if (!current.contains(target))
+            incoming[target].insert(key);
+    }
+
+    if (targets.isEmpty())
+        outgoing.remove(key); // Invalidates 'current'
+    else
+        current = targets;
+    stamps.insert(key, stamp);
+    dirty = true;
+}
+
+void LinkIndex::removePage(const QString &key)
+{
+    const QSet<QString> targets = outgoing.take(key);
+    for (const QString &target : targets) {
+        auto it = incoming.find(target);
+        if (it != incoming.end()) {
+            it->remove(key);
+            if (it->isEmpty())
+                incoming.erase(it);
+        }
+    }
+    stamps.remove(key);
+    dirty = true;
+}
+
+void LinkIndex::movePages(const QList<QPair<QString, QString>> &moves)
+{
+    for (const auto &move : moves) {
+        if (!stamps.contains(move.first))
+            continue;
+        const QSet<QString> targets = outgoing.take(move.first);
+        for (const QString &target : targets) {
+            QSet<QString> &sources = incoming[target];
+            sources.remove(move.first);
+            sources.insert(move.second);
+        }
+        if (!targets.isEmpty())
+            outgoing.insert(move.second, targets);
+        stamps.insert(move.second, stamps.take(move.first));
+    }
+    dirty = true;
+}
+
+QStringList LinkIndex::backlinks(const QString &title) const
+{
+    const QSet<QString> sources = incoming.value(normalized(title));
+    QStringList keys(sources.cbegin(), sources.cend());
+    keys.sort();
+    return keys;
+}
@@ -1,5 +1,12 @@
 // src/MainWindow.cpp
 #include "MainWindow.h" // Include the header file for our main window
+#include "PageHistory.h" // Per-page revision store
+#include "HistoryDialog.h" // Revision list + diff viewer
+#include "LinkIndex.h" // [[Page]] link graph
+#include "TreeFilter.h" // Filter boxes for the section/page trees
+#include "LibraryWatcher.h" // Change notifications between app instances
+#include "OpLog.h" // Edit log for syncing libraries
+#include "LibrarySync.h" // Two-way sync with another library folder
 
 // Include necessary Qt headers
 #include <QtWidgets> // Includes most common widgets (QLabel, QPushButton, Layouts, etc.)
@@ -10,9 +17,43 @@
 #include <QInputDialog>  // For getting names for new items
 #include <QDebug> // For printing debug messages
 #include <QMessageBox> // For showing warnings
+#include <QCloseEvent>
+#include <functional>
+
+namespace {
+
+// Placeholder pages of the sample notebooks (not stored anywhere)
+struct SamplePages {
+    QString notebook;
+    QString section;
+    QStringList pages;
+};
+
+const QList<SamplePages> &samplePages()
+{
+    static const QList<SamplePages> samples = {
+        {"Aspekte B1-B2", "1", {"1", "Explain"}},
+        {"Aspekte B1-B2", "2", {"2a", "2b Notes"}},
+        {"PC3", "Chapter A", {"Intro", "Topic 1"}},
+    };
+    return samples;
+}
+
+// (old key, new key) for each of 'keys' that is 'oldKey' or one of its subpages
+QList<QPair<QString, QString>> subtreeMoves(const QStringList &keys, const QString &oldKey, const QString &newKey)
+{
+    QList<QPair<QString, QString>> moves;
+    for (const QString &key : keys) {
+        if (key == oldKey || key.startsWith(oldKey + PageHistory::keySeparator()))
+            moves.append({key, newKey + key.mid(oldKey.size())});
+    }
+    return moves;
+}
+
+} // namespace
 
 // Constructor
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(const QString &library, QWidget *parent)
     : QMainWindow(parent) // Call the base class constructor
 {
     // Initialize models first (parented to 'this' for auto memory management)
@@ -20,6 +61,22 @@ MainWindow::MainWindow(QWidget *parent)
     sectionModel = new QStandardItemModel(this);
     pageModel = new QStandardItemModel(this);
 
+    // Everything the app saves lives under one library folder
+    libraryPath = library.isEmpty() ? LibrarySync::defaultLibraryPath() : library;
+    pageHistory = new PageHistory(libraryPath + "/history");
+    linkIndex = new LinkIndex(libraryPath + "/links.idx");
+    linkIndex->load();
+    syncLinkIndex(); // Only pages saved since the last run are re-read
+    opLog = new OpLog(libraryPath + "/oplog");
+    LibrarySync::recordUnloggedPages(*opLog, *pageHistory); // Pages saved without an op (reads only changed ones)
+
+    // Other instances on the same library tell us which pages they touched
+    libraryWatcher = new LibraryWatcher(libraryPath, this);
+    connect(libraryWatcher, &LibraryWatcher::pageSaved, this, &MainWindow::onExternalPageSaved);
+    connect(libraryWatcher, &LibraryWatcher::pageMoved, this, &MainWindow::onExternalPageMoved);
+    connect(libraryWatcher, &LibraryWatcher::resyncNeeded, this, &MainWindow::onExternalResync);
+    connect(libraryWatcher, &LibraryWatcher::structureChanged, this, &MainWindow::onExternalStructureChanged);
+
     setupUI(); // Create the UI elements
     createActions(); // Create menu/toolbar actions
     createMenus(); // Create the main menu bar
@@ -36,6 +93,40 @@ MainWindow::MainWindow(QWidget *parent)
 MainWindow::~MainWindow()
 {
     // Qt's parent-child mechanism handles deleting child widgets and models
+    delete linkIndex;   // Not QObjects
+    delete opLog;
+    delete pageHistory;
+}
+
+// Save the open page before the window goes away
+void MainWindow::closeEvent(QCloseEvent *event)
+{
+    saveCurrentPage();
+
+    // Let moves made by other instances re-key pending edits first (this also
+    // retries them), then make a last try for the rest (e.g. a locked page)
+    libraryWatcher->checkJournal();
+    QCoreApplication::sendPostedEvents(libraryWatcher, QEvent::MetaCall);
+    for (auto it = unsavedPages.begin(); it != unsavedPages.end();) {
+        if (!keepUnsaved(savePageText(it.key(), it.value())))
+            it = unsavedPages.erase(it);
+        else
+            ++it;
+    }
+    if (!unsavedPages.isEmpty()
+        && QMessageBox::warning(this, tr("Unsaved Changes"),
+                                tr("%n page(s) could not be saved. Quit anyway and lose those changes?", "",
+                                   int(unsavedPages.size())),
+                                QMessageBox::Discard | QMessageBox::Cancel) != QMessageBox::Discard) {
+        event->ignore();
+        return;
+    }
+
+    if (linkIndex->isDirty())
+        linkIndex->save();
+    opLog->saveLoggedSizes();
+    opLog->saveState();
+    QMainWindow::closeEvent(event);
 }
 
 // --- Setup the main UI structure ---
@@ -75,8 +166,13 @@ void MainWindow::setupUI()
     addSectionButton->setObjectName("addButton");
     addSectionButton->setIcon(style()->standardIcon(QStyle::SP_FileDialogNewFolder));
     addSectionButton->setToolTip(tr("Add Section"));
+    QLineEdit *sectionFilterEdit = new QLineEdit();
+    sectionFilterEdit->setObjectName("filterEdit"); // For QSS
+    sectionFilterEdit->setPlaceholderText(tr("Filter"));
+    sectionFilterEdit->setClearButtonEnabled(true);
     sectionHeaderLayout->addWidget(sectionLabel);
     sectionHeaderLayout->addStretch();
+    sectionHeaderLayout->addWidget(sectionFilterEdit);
     sectionHeaderLayout->addWidget(addSectionButton);
 
     // Page Header
@@ -90,8 +186,13 @@ void MainWindow::setupUI()
     addPageButton->setObjectName("addButton");
     addPageButton->setIcon(style()->standardIcon(QStyle::SP_FileIcon)); // Document icon
     addPageButton->setToolTip(tr("Add Page"));
+    QLineEdit *pageFilterEdit = new QLineEdit();
+    pageFilterEdit->setObjectName("filterEdit");
+    pageFilterEdit->setPlaceholderText(tr("Filter"));
+    pageFilterEdit->setClearButtonEnabled(true);
     pageHeaderLayout->addWidget(pageLabel);
     pageHeaderLayout->addStretch();
+    pageHeaderLayout->addWidget(pageFilterEdit);
     pageHeaderLayout->addWidget(addPageButton);
 
     // --- Create List Views ---
@@ -112,6 +213,22 @@ void MainWindow::setupUI()
     pageTreeView->setEditTriggers(QAbstractItemView::NoEditTriggers); // Renamed variable
     pageTreeView->setHeaderHidden(true); // Typically hide header for simple lists/trees
 
+    // "Linked from" panel: pages whose [[links]] point at the open page
+    QWidget *backlinkHeader = new QWidget();
+    backlinkHeader->setObjectName("panelHeader");
+    QHBoxLayout *backlinkHeaderLayout = new QHBoxLayout(backlinkHeader);
+    backlinkHeaderLayout->setContentsMargins(5, 3, 5, 3);
+    backlinkHeaderLayout->addWidget(new QLabel(tr("Linked from")));
+    backlinkHeaderLayout->addStretch();
+
+    backlinkList = new QListWidget();
+    backlinkList->setObjectName("backlinkList"); // For QSS
+    backlinkList->setMaximumHeight(160); // Keep most of the panel for the page tree
+
+    // Filters hide rows in the views directly, so expansion state survives
+    sectionFilter = new TreeFilter(sectionTreeView, sectionModel, this);
+    pageFilter = new TreeFilter(pageTreeView, pageModel, this);
+
     // Enable context menus
     sectionTreeView->setContextMenuPolicy(Qt::CustomContextMenu); // Renamed variable
     pageTreeView->setContextMenuPolicy(Qt::CustomContextMenu);    // Renamed variable
@@ -137,12 +254,14 @@ void MainWindow::setupUI()
     pageLayout->setContentsMargins(0, 0, 0, 0);
     pageLayout->setSpacing(0);
     pageLayout->addWidget(pageHeader);
-    pageLayout->addWidget(pageTreeView); // Changed to TreeView
+    pageLayout->addWidget(pageTreeView, 1); // Changed to TreeView
+    pageLayout->addWidget(backlinkHeader);
+    pageLayout->addWidget(backlinkList);
 
     // --- Create Editor ---
     noteEditor = new QTextEdit();
     noteEditor->setObjectName("noteEditor"); // For QSS
-    noteEditor->setAcceptRichText(true); // Enable rich text features
+    noteEditor->setAcceptRichText(false); // Pages are stored as plain text (history, links, sync)
 
     // --- Assemble Splitters ---
     // Inner splitter for Sections and Pages
@@ -187,6 +306,13 @@ void MainWindow::setupUI()
     connect(sectionTreeView, &QWidget::customContextMenuRequested, this, &MainWindow::showSectionContextMenu);
     connect(pageTreeView, &QWidget::customContextMenuRequested, this, &MainWindow::showPageContextMenu);
 
+    // Filter as you type
+    connect(sectionFilterEdit, &QLineEdit::textChanged, sectionFilter, &TreeFilter::setPattern);
+    connect(pageFilterEdit, &QLineEdit::textChanged, pageFilter, &TreeFilter::setPattern);
+
+    // Jump to a page from the "Linked from" panel
+    connect(backlinkList, &QListWidget::itemActivated, this, &MainWindow::onBacklinkActivated);
+
     // Connect "Add" buttons to their respective slots
     connect(addNotebookButton, &QToolButton::clicked, this, &MainWindow::addNotebook);
     connect(addSectionButton, &QToolButton::clicked, this, &MainWindow::addSection);
@@ -204,6 +330,7 @@ void MainWindow::loadInitialData()
     notebookItems.append(new QStandardItem(style()->standardIcon(QStyle::SP_DirIcon), "VHK B2"));
     notebookItems.append(new QStandardItem(style()->standardIcon(QStyle::SP_DirIcon), "PC3"));
     notebookModel->invisibleRootItem()->appendRows(notebookItems);
+    mergeStructure(); // Notebooks added earlier or synced from another library
 
     // Select the first notebook to trigger loading sections (if any)
     if (notebookModel->rowCount() > 0) {
@@ -237,6 +364,24 @@ void MainWindow::createActions()
     promoteSubpageAction = new QAction(tr("Promote Subpage"), this);
     connect(promoteSubpageAction, &QAction::triggered, this, &MainWindow::promoteSubpage);
 
+    renamePageAction = new QAction(tr("Rename Page..."), this);
+    connect(renamePageAction, &QAction::triggered, this, &MainWindow::renamePage);
+
+    // Page History Actions
+    savePageAction = new QAction(tr("&Save Page"), this);
+    savePageAction->setShortcut(QKeySequence::Save); // Ctrl+S / Cmd+S
+    savePageAction->setStatusTip(tr("Save the current page as a new revision"));
+    connect(savePageAction, &QAction::triggered, this, &MainWindow::saveCurrentPage);
+
+    pageHistoryAction = new QAction(tr("Page &History..."), this);
+    pageHistoryAction->setShortcut(QKeySequence(tr("Ctrl+Shift+H")));
+    pageHistoryAction->setStatusTip(tr("Browse and restore earlier revisions of the current page"));
+    connect(pageHistoryAction, &QAction::triggered, this, &MainWindow::showPageHistory);
+
+    syncLibraryAction = new QAction(tr("S&ync With Library..."), this);
+    syncLibraryAction->setStatusTip(tr("Exchange changes with another library folder"));
+    connect(syncLibraryAction, &QAction::triggered, this, &MainWindow::syncWithLibrary);
+
     // Add icons later if desired
 }
 
@@ -244,7 +389,10 @@ void MainWindow::createActions()
 void MainWindow::createMenus()
 {
     fileMenu = menuBar()->addMenu(tr("&File"));
-    // Add Save, Open etc. actions here later
+    fileMenu->addAction(savePageAction);
+    fileMenu->addAction(pageHistoryAction);
+    fileMenu->addSeparator();
+    fileMenu->addAction(syncLibraryAction);
     fileMenu->addSeparator();
     fileMenu->addAction(exitAction);
     // Removed View menu as toggle action is gone
@@ -261,9 +409,12 @@ void MainWindow::createStatusBar()
 // Slot called when a different notebook is selected
 void MainWindow::onNotebookSelected(const QModelIndex &index)
 {
+    saveCurrentPage();     // Keep edits to the page we are leaving
     sectionModel->clear(); // Clear previous sections
     pageModel->clear();    // Clear previous pages
     noteEditor->clear();   // Clear editor
+    currentPageKey.clear();
+    backlinkList->clear();
 
     // Find header labels using findChild (safer than assuming order)
     QLabel* sectionHeaderLabel = findChild<QLabel*>("sectionHeaderLabel");
@@ -298,6 +449,7 @@ void MainWindow::onNotebookSelected(const QModelIndex &index)
     // Add items to the section model
     sectionModel->invisibleRootItem()->appendRows(sectionItems);
     // --- End Placeholder ---
+    mergeStructure(); // Sections and groups added earlier or synced from another library
 
      // Automatically select the first section if sections were loaded
       if (sectionModel->rowCount() > 0) {
@@ -309,8 +461,11 @@ void MainWindow::onNotebookSelected(const QModelIndex &index)
 // Slot called when a different section is selected
 void MainWindow::onSectionSelected(const QModelIndex &index)
 {
+    saveCurrentPage(); // Keep edits to the page we are leaving
     pageModel->clear(); // Clear previous pages
     noteEditor->clear(); // Clear editor
+    currentPageKey.clear();
+    backlinkList->clear();
 
     QLabel* pageHeaderLabel = findChild<QLabel*>("pageHeaderLabel");
 
@@ -333,19 +488,16 @@ void MainWindow::onSectionSelected(const QModelIndex &index)
     // --- Placeholder Page Loading ---
     // In a real app, load pages for 'sectionName' in 'currentNotebook' from storage
     QList<QStandardItem *> pageItems;
-     if (currentNotebook == "Aspekte B1-B2" && sectionName == "1") {
-        pageItems.append(new QStandardItem(style()->standardIcon(QStyle::SP_FileIcon), "1"));
-        pageItems.append(new QStandardItem(style()->standardIcon(QStyle::SP_FileIcon), "Explain"));
-    } else if (currentNotebook == "Aspekte B1-B2" && sectionName == "2") {
-        pageItems.append(new QStandardItem(style()->standardIcon(QStyle::SP_FileIcon), "2a"));
-        pageItems.append(new QStandardItem(style()->standardIcon(QStyle::SP_FileIcon), "2b Notes"));
-    } else if (currentNotebook == "PC3" && sectionName == "Chapter A") {
-        pageItems.append(new QStandardItem(style()->standardIcon(QStyle::SP_FileIcon), "Intro"));
-        pageItems.append(new QStandardItem(style()->standardIcon(QStyle::SP_FileIcon), "Topic 1"));
+    for (const SamplePages &sample : samplePages()) {
+        if (sample.notebook == currentNotebook && sample.section == sectionName) {
+            for (const QString &title : sample.pages)
+                pageItems.append(new QStandardItem(style()->standardIcon(QStyle::SP_FileIcon), title));
+        }
     }
     // Add items to the page model
     pageModel->invisibleRootItem()->appendRows(pageItems);
     // --- End Placeholder ---
+    appendStoredPages(currentNotebook, sectionName); // Pages added and saved earlier
 
       // Automatically select the first page if pages were loaded
       if (pageModel->rowCount() > 0) {
@@ -357,7 +509,10 @@ void MainWindow::onSectionSelected(const QModelIndex &index)
 // Slot called when a different page is selected
 void MainWindow::onPageSelected(const QModelIndex &index)
 {
+    saveCurrentPage(); // Keep edits to the page we are leaving
     noteEditor->clear(); // Clear previous content
+    currentPageKey.clear();
+    backlinkList->clear();
 
     if (!index.isValid()) return; // No valid page selected
 
@@ -370,11 +525,481 @@ void MainWindow::onPageSelected(const QModelIndex &index)
 
     qDebug() << "Page selected:" << pageName << "in section" << currentSection << "of notebook" << currentNotebook;
 
-    // --- Placeholder Content Loading ---
-    // In a real app, load content for 'pageName' (likely using IDs stored in the model item)
-    noteEditor->setPlainText(tr("Content for page '%1' in section '%2' of notebook '%3'.\n\nReplace this with actual loaded content.")
-                             .arg(pageName).arg(currentSection).arg(currentNotebook));
-    // --- End Placeholder ---
+    // Load the latest saved revision, falling back to placeholder text
+    currentPageKey = PageHistory::keyFor(pagePath(index));
+    if (pageHistory->hasPage(currentPageKey)) {
+        noteEditor->setPlainText(pageHistory->latestText(currentPageKey));
+    } else {
+        // --- Placeholder Content Loading ---
+        noteEditor->setPlainText(tr("Content for page '%1' in section '%2' of notebook '%3'.\n\nReplace this with actual loaded content.")
+                                 .arg(pageName).arg(currentSection).arg(currentNotebook));
+        // --- End Placeholder ---
+    }
+    // Only real edits get saved; edits whose save failed are shown again, still unsaved
+    auto unsaved = unsavedPages.constFind(currentPageKey);
+    if (unsaved != unsavedPages.cend())
+        noteEditor->setPlainText(unsaved.value());
+    noteEditor->document()->setModified(unsaved != unsavedPages.cend());
+    refreshBacklinks();
+}
+
+// Build the history path of a page: notebook, section, then the page chain down from the root
+QStringList MainWindow::pagePath(const QModelIndex &pageIndex) const
+{
+    QStringList path;
+    for (QModelIndex index = pageIndex; index.isValid(); index = index.parent())
+        path.prepend(pageModel->data(index, Qt::DisplayRole).toString());
+    path.prepend(sectionModel->data(sectionTreeView->currentIndex(), Qt::DisplayRole).toString());
+    path.prepend(notebookModel->data(notebookListView->currentIndex(), Qt::DisplayRole).toString());
+    return path;
+}
+
+// Add pages that have saved history (or were added through the op log) under this section but are not in the model yet
+void MainWindow::appendStoredPages(const QString &notebook, const QString &section)
+{
+    const QStringList keys = pageHistory->pageKeys() + opLog->structure().pageKeys();
+    for (const QString &key : keys) {
+        const QStringList path = PageHistory::pathFor(key);
+        if (path.size() >= 3 && path[0] == notebook && path[1] == section)
+            pageItemFor(path, true);
+    }
+}
+
+// Find the item for a page of the shown section by walking down its page chain.
+// With 'create', missing levels are added instead of giving up.
+QStandardItem *MainWindow::pageItemFor(const QStringList &path, bool create)
+{
+    QStandardItem *item = pageModel->invisibleRootItem();
+    for (int level = 2; level < path.size() && item; ++level) {
+        QStandardItem *child = nullptr;
+        for (int row = 0; row < item->rowCount(); ++row) {
+            if (item->child(row)->text() == path[level]) {
+                child = item->child(row);
+                break;
+            }
+        }
+        if (!child && create) {
+            child = new QStandardItem(style()->standardIcon(QStyle::SP_FileIcon), path[level]);
+            item->appendRow(child);
+        }
+        item = child;
+    }
+    return item == pageModel->invisibleRootItem() ? nullptr : item;
+}
+
+// Slot for "Save Page": store the editor content as a new revision if it changed
+void MainWindow::saveCurrentPage()
+{
+    if (currentPageKey.isEmpty() || !noteEditor->document()->isModified())
+        return;
+
+    const QString text = noteEditor->toPlainText();
+    const int revision = savePageText(currentPageKey, text);
+    if (revision == PageHistory::PageMoved) {
+        // Renamed or promoted in another window before we heard of it: once the
+        // move notification arrives, the edit follows the page and is saved there
+        unsavedPages.insert(currentPageKey, text);
+        libraryWatcher->checkJournal();
+        statusBar()->showMessage(tr("This page was moved in another window; saving it at its new place"), 3000);
+        return;
+    }
+    if (revision == PageHistory::SaveFailed) {
+        // Keep the edit: the document stays modified, and the text comes back with the page
+        unsavedPages.insert(currentPageKey, text);
+        QMessageBox::warning(this, tr("Save Page"),
+                             tr("Could not save '%1'. Your changes are kept and will be saved "
+                                "again with Ctrl+S or when you leave the page.")
+                                 .arg(PageHistory::pathFor(currentPageKey).last()));
+        return;
+    }
+    unsavedPages.remove(currentPageKey);
+    noteEditor->document()->setModified(false);
+    if (revision >= 0)
+        statusBar()->showMessage(tr("Saved revision %1").arg(revision + 1), 2000);
+}
+
+bool MainWindow::keepUnsaved(int saveResult) const
+{
+    return saveResult == PageHistory::SaveFailed || saveResult == PageHistory::PageMoved;
+}
+
+// Edits waiting for a retry follow their page (and its subpages) to a new key
+void MainWindow::rekeyUnsavedPages(const QString &oldKey, const QString &newKey)
+{
+    const QStringList keys = unsavedPages.keys();
+    for (const QString &key : keys) {
+        if (key == oldKey || key.startsWith(oldKey + PageHistory::keySeparator()))
+            unsavedPages.insert(newKey + key.mid(oldKey.size()), unsavedPages.take(key));
+    }
+}
+
+// Store 'text' as a new revision of a page and log the edit for sync.
+// Returns the revision index or a PageHistory::SaveResult.
+int MainWindow::savePageText(const QString &key, const QString &text)
+{
+    const QString previous = pageHistory->latestText(key);
+    const int revision = pageHistory->saveRevision(key, text);
+    if (revision >= 0) {
+        if (opLog->recordText(key, previous, text))
+            opLog->setLoggedSize(key, pageHistory->storedSize(key));
+        linkIndex->updatePage(key, text, pageHistory->storedSize(key));
+        libraryWatcher->announceSaved(key);
+    }
+    return revision;
+}
+
+// Navigate to a page: select its notebook and section (loading their contents), then the page itself
+bool MainWindow::selectPagePath(const QStringList &path)
+{
+    if (path.size() < 3) return false;
+
+    const QList<QStandardItem *> notebooks = notebookModel->findItems(path[0]);
+    if (notebooks.isEmpty()) return false;
+    notebookListView->setCurrentIndex(notebooks.first()->index());
+
+    // Sections may sit inside section groups
+    const QList<QStandardItem *> sections = sectionModel->findItems(path[1], Qt::MatchExactly | Qt::MatchRecursive);
+    if (sections.isEmpty()) return false;
+    sectionTreeView->setCurrentIndex(sections.first()->index());
+
+    QStandardItem *item = pageItemFor(path, false);
+    if (!item) return false;
+
+    pageTreeView->setCurrentIndex(item->index());
+    pageTreeView->scrollTo(item->index()); // Also expands collapsed parents
+    return true;
+}
+
+// Bring the link index up to date with pages saved since it was last written
+void MainWindow::syncLinkIndex()
+{
+    const QStringList keys = pageHistory->pageKeys();
+    for (const QString &key : keys) {
+        const qint64 size = pageHistory->storedSize(key);
+        if (linkIndex->stamp(key) != size)
+            linkIndex->updatePage(key, pageHistory->latestText(key), size);
+    }
+    // Drop pages whose history went away (e.g. moved by a promote)
+    const QStringList indexed = linkIndex->pageKeys();
+    for (const QString &key : indexed) {
+        if (!pageHistory->hasPage(key))
+            linkIndex->removePage(key);
+    }
+    if (linkIndex->isDirty())
+        linkIndex->save();
+}
+
+// List the pages linking to the open page
+void MainWindow::refreshBacklinks()
+{
+    backlinkList->clear();
+    if (currentPageKey.isEmpty()) return;
+
+    const QString title = PageHistory::pathFor(currentPageKey).last();
+    const QStringList sources = linkIndex->backlinks(title);
+    for (const QString &source : sources) {
+        if (source == currentPageKey) continue; // Self-links are not interesting
+        const QStringList path = PageHistory::pathFor(source);
+        QListWidgetItem *item = new QListWidgetItem(style()->standardIcon(QStyle::SP_FileLinkIcon),
+                                                    tr("%1 (%2 / %3)").arg(path.last(), path[0], path[1]));
+        item->setToolTip(path.join(" / "));
+        item->setData(Qt::UserRole, source);
+        backlinkList->addItem(item);
+    }
+}
+
+// Slot called when a page in the "Linked from" panel is activated
+void MainWindow::onBacklinkActivated(QListWidgetItem *item)
+{
+    if (!item) return;
+    const QStringList path = PageHistory::pathFor(item->data(Qt::UserRole).toString());
+    if (!selectPagePath(path))
+        statusBar()->showMessage(tr("Could not open '%1'").arg(path.join(" / ")), 3000);
+}
+
+// Re-key a page (and its subpages) in the history and link index, and tell other instances
+void MainWindow::movePageHistory(const QString &oldKey, const QString &newKey)
+{
+    opLog->record(OpLog::MovePage, oldKey, newKey); // Subpages move along on every replica
+    const QList<QPair<QString, QString>> moves = pageHistory->movePages(oldKey, newKey);
+    rekeyUnsavedPages(oldKey, newKey);
+    linkIndex->movePages(moves); // Keep link sources on the new keys
+    // One announcement for the whole subtree, even if none of it had history yet:
+    // other instances still show the old rows
+    libraryWatcher->announceMoved(oldKey, newKey);
+}
+
+// Slot called when another instance saved a page
+void MainWindow::onExternalPageSaved(const QString &key)
+{
+    if (pageHistory->refreshPage(key)) // Reads only the appended revisions
+        applyExternalPageChange(key);
+}
+
+// Bring the models, the link index and the open page up to date with one changed page
+void MainWindow::applyExternalPageChange(const QString &key)
+{
+    if (!pageHistory->hasPage(key)) {
+        linkIndex->removePage(key);
+        return;
+    }
+    const QString text = pageHistory->latestText(key);
+    linkIndex->updatePage(key, text, pageHistory->storedSize(key));
+
+    const QStringList path = PageHistory::pathFor(key);
+    if (path.size() < 3) return;
+
+    // Add just the nodes this page needs, where they are currently shown
+    if (notebookModel->findItems(path[0]).isEmpty())
+        notebookModel->appendRow(new QStandardItem(style()->standardIcon(QStyle::SP_DirIcon), path[0]));
+    const QStringList shown = pagePath(QModelIndex()); // Current notebook and section
+    if (shown[0] == path[0] && sectionModel->findItems(path[1], Qt::MatchExactly | Qt::MatchRecursive).isEmpty())
+        sectionModel->appendRow(new QStandardItem(style()->standardIcon(QStyle::SP_DirLinkIcon), path[1]));
+    if (shown == path.mid(0, 2))
+        pageItemFor(path, true);
+
+    if (key == currentPageKey) {
+        if (noteEditor->document()->isModified()) {
+            // Saving will still go on top of their revision; both stay in the history
+            statusBar()->showMessage(tr("This page was changed in another window"), 5000);
+        } else {
+            const int cursor = noteEditor->textCursor().position();
+            noteEditor->setPlainText(text);
+            noteEditor->document()->setModified(false);
+            QTextCursor restored = noteEditor->textCursor();
+            restored.setPosition(qMin(cursor, int(text.size())));
+            noteEditor->setTextCursor(restored);
+        }
+    }
+    refreshBacklinks();
+}
+
+// Slot called when another instance promoted or renamed a page; its subpages moved along
+void MainWindow::onExternalPageMoved(const QString &oldKey, const QString &newKey)
+{
+    const QList<QPair<QString, QString>> moves = subtreeMoves(pageHistory->pageKeys(), oldKey, newKey);
+    for (const auto &move : moves) {
+        pageHistory->refreshPage(move.first);
+        pageHistory->refreshPage(move.second);
+    }
+    pageHistory->refreshPage(newKey); // Also when we had no history for it
+    linkIndex->movePages(subtreeMoves(linkIndex->pageKeys(), oldKey, newKey));
+    if (currentPageKey == oldKey || currentPageKey.startsWith(oldKey + PageHistory::keySeparator()))
+        currentPageKey = newKey + currentPageKey.mid(oldKey.size());
+
+    // Edits whose save found the page gone can be saved at its new key now
+    rekeyUnsavedPages(oldKey, newKey);
+    const QStringList pending = unsavedPages.keys();
+    for (const QString &key : pending) {
+        if (key != newKey && !key.startsWith(newKey + PageHistory::keySeparator()))
+            continue;
+        if (key == currentPageKey && noteEditor->document()->isModified())
+            saveCurrentPage(); // Saves the editor text, which includes the edit
+        else if (!keepUnsaved(savePageText(key, unsavedPages.value(key))))
+            unsavedPages.remove(key);
+    }
+
+    const QStringList oldPath = PageHistory::pathFor(oldKey);
+    const QStringList newPath = PageHistory::pathFor(newKey);
+    if (oldPath.size() < 3 || newPath.size() < 3 || pagePath(QModelIndex()) != oldPath.mid(0, 2))
+        return;
+    QStandardItem *item = pageItemFor(oldPath, false);
+    if (!item) return; // Not shown, or already moved along with its parent
+
+    if (oldPath.mid(0, oldPath.size() - 1) == newPath.mid(0, newPath.size() - 1)) {
+        item->setText(newPath.last()); // Renamed in place
+    } else {
+        // Promoted: move the row (with its subpages) under the new parent, keeping the selection
+        const bool wasCurrent = item->index() == pageTreeView->currentIndex();
+        QStandardItem *oldParent = item->parent() ? item->parent() : pageModel->invisibleRootItem();
+        QStandardItem *newParent = newPath.size() == 3
+            ? pageModel->invisibleRootItem()
+            : pageItemFor(newPath.mid(0, newPath.size() - 1), true);
+        const QList<QStandardItem *> row = oldParent->takeRow(item->row());
+        newParent->appendRow(row);
+        if (wasCurrent)
+            pageTreeView->setCurrentIndex(row.first()->index());
+    }
+    refreshBacklinks();
+}
+
+// Slot called when change notifications were missed: compare every page file instead,
+// and rebuild the structure from the op log
+void MainWindow::onExternalResync()
+{
+    const QStringList changed = pageHistory->refresh();
+    for (const QString &key : changed)
+        applyExternalPageChange(key);
+    opLog->refresh();
+    mergeStructure();
+    removeStalePageRows(); // Pages moved away leave their old rows behind
+}
+
+void MainWindow::removeStalePageRows()
+{
+    const QStringList stored = pageHistory->pageKeys();
+    QSet<QString> live(stored.cbegin(), stored.cend());
+    for (const QString &key : opLog->structure().pageKeys())
+        live.insert(key);
+    for (const SamplePages &sample : samplePages()) {
+        for (const QString &title : sample.pages)
+            live.insert(PageHistory::keyFor({sample.notebook, sample.section, title}));
+    }
+
+    // Children first, so a parent only goes once nothing is left under it
+    const std::function<void(QStandardItem *)> prune = [&](QStandardItem *parent) {
+        for (int row = parent->rowCount() - 1; row >= 0; --row) {
+            QStandardItem *item = parent->child(row);
+            prune(item);
+            const QString key = PageHistory::keyFor(pagePath(item->index()));
+            if (!item->hasChildren() && key != currentPageKey && !live.contains(key))
+                parent->removeRow(row);
+        }
+    };
+    prune(pageModel->invisibleRootItem());
+}
+
+// Slot called when notebooks, sections or pages were added by another instance or a sync
+void MainWindow::onExternalStructureChanged()
+{
+    opLog->refresh(); // Reads only the ops appended since the last look
+    mergeStructure();
+}
+
+// Add what the op log knows about and the models do not show yet: notebooks,
+// the sections of the shown notebook and the pages of the shown section
+void MainWindow::mergeStructure()
+{
+    const OpLog::Structure &structure = opLog->structure();
+    for (const QString &notebook : structure.notebooks) {
+        if (notebookModel->findItems(notebook).isEmpty())
+            notebookModel->appendRow(new QStandardItem(style()->standardIcon(QStyle::SP_DirIcon), notebook));
+    }
+
+    if (!notebookListView->currentIndex().isValid()) return;
+    const QStringList shown = pagePath(QModelIndex()); // Current notebook and section
+
+    const QStringList groups = structure.sectionGroups.value(shown[0]);
+    for (const QString &group : groups) {
+        if (!sectionModel->findItems(group).isEmpty()) continue;
+        QStandardItem *groupItem = new QStandardItem(style()->standardIcon(QStyle::SP_DirClosedIcon), group);
+        QFont font = groupItem->font();
+        font.setBold(true); // Marks section groups, as in addSectionGroup()
+        groupItem->setFont(font);
+        sectionModel->appendRow(groupItem);
+    }
+    const QList<QPair<QString, QString>> sections = structure.sections.value(shown[0]);
+    for (const auto &section : sections) {
+        if (!sectionModel->findItems(section.first, Qt::MatchExactly | Qt::MatchRecursive).isEmpty())
+            continue;
+        QStandardItem *parentItem = sectionModel->invisibleRootItem();
+        const QList<QStandardItem *> groupItems = sectionModel->findItems(section.second);
+        if (!section.second.isEmpty() && !groupItems.isEmpty() && groupItems.first()->font().bold())
+            parentItem = groupItems.first();
+        parentItem->appendRow(new QStandardItem(style()->standardIcon(QStyle::SP_DirLinkIcon), section.first));
+    }
+
+    if (sectionTreeView->currentIndex().isValid()) {
+        for (const QString &key : structure.pageKeys()) {
+            const QStringList path = PageHistory::pathFor(key);
+            if (path.size() >= 3 && path.mid(0, 2) == shown)
+                pageItemFor(path, true);
+        }
+    }
+}
+
+// Slot for "Sync With Library...": exchange missing ops with another library folder.
+// The changes reach this window through the library journal like any other instance's.
+void MainWindow::syncWithLibrary()
+{
+    saveCurrentPage(); // So the open page takes part in the sync
+    const QString other = QFileDialog::getExistingDirectory(this, tr("Choose the Library to Sync With"));
+    if (other.isEmpty()) return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const LibrarySync::Result result = LibrarySync::sync(libraryPath, other);
+    QApplication::restoreOverrideCursor();
+    if (!result.ok) {
+        QMessageBox::warning(this, tr("Sync With Library"), result.summary());
+        return;
+    }
+    if (!result.conflictPages.isEmpty()) {
+        // Someone's text is no longer on top of these pages: say so rather than flash it by
+        QMessageBox::information(this, tr("Sync With Library"),
+                                 tr("These pages were edited in both libraries in the same place. The newer "
+                                    "edit is now on top; the other one is in the page history:\n\n%1")
+                                     .arg(result.conflictPages.join('\n')));
+    }
+    statusBar()->showMessage(result.summary(), 5000);
+}
+
+// Point [[oldTitle]] links at the page renamed away from 'oldKey', one new revision
+// per referencing page. Returns the number of pages rewritten, or -1 if another
+// page still has the old title (the links may mean that one, so they are kept).
+int MainWindow::updateLinksAfterRename(const QString &oldKey, const QString &newTitle)
+{
+    const QString oldTitle = PageHistory::pathFor(oldKey).last();
+    const QString oldTarget = LinkIndex::normalized(oldTitle);
+
+    // Saved pages, pages known from the op log and the sample pages...
+    QStringList keys = pageHistory->pageKeys() + opLog->structure().pageKeys();
+    for (const SamplePages &sample : samplePages()) {
+        for (const QString &title : sample.pages)
+            keys.append(PageHistory::keyFor({sample.notebook, sample.section, title}));
+    }
+    for (const QString &key : std::as_const(keys)) {
+        if (key != oldKey && LinkIndex::normalized(PageHistory::pathFor(key).last()) == oldTarget)
+            return -1;
+    }
+    // ...and pages of the shown section that so far exist only in the model
+    QList<QStandardItem *> items{pageModel->invisibleRootItem()};
+    while (!items.isEmpty()) {
+        QStandardItem *item = items.takeLast();
+        for (int row = 0; row < item->rowCount(); ++row) {
+            if (LinkIndex::normalized(item->child(row)->text()) == oldTarget)
+                return -1;
+            items.append(item->child(row));
+        }
+    }
+
+    int updated = 0;
+    const QStringList sources = linkIndex->backlinks(oldTitle);
+    for (const QString &source : sources) {
+        const QString text = pageHistory->latestText(source);
+        const QString renamed = LinkIndex::renameLinks(text, oldTitle, newTitle);
+        if (renamed == text)
+            continue;
+        const int revision = savePageText(source, renamed);
+        if (keepUnsaved(revision))
+            unsavedPages.insert(source, renamed); // Retried like any other failed save
+        if (revision < 0)
+            continue;
+        if (source == currentPageKey) {
+            noteEditor->setPlainText(renamed);
+            noteEditor->document()->setModified(false);
+        }
+        ++updated;
+    }
+    linkIndex->save(); // One write for the whole batch
+    return updated;
+}
+
+// Slot for "Page History...": show the revisions of the open page, optionally restoring one
+void MainWindow::showPageHistory()
+{
+    saveCurrentPage(); // So the newest revision matches what is on screen
+    if (currentPageKey.isEmpty() || pageHistory->revisionCount(currentPageKey) == 0) {
+        QMessageBox::information(this, tr("Page History"), tr("This page has no saved revisions yet."));
+        return;
+    }
+
+    HistoryDialog dialog(pageHistory, currentPageKey, this);
+    if (dialog.exec() == QDialog::Accepted) {
+        // Restoring is itself a new revision, so nothing is lost
+        noteEditor->setPlainText(dialog.restoredText());
+        noteEditor->document()->setModified(true);
+        saveCurrentPage();
+    }
 }
 
 // Slot for the "Add Notebook" button
@@ -387,6 +1012,8 @@ void MainWindow::addNotebook()
                                          "", &ok);
     if (ok && !text.isEmpty()) {
         notebookModel->appendRow(new QStandardItem(style()->standardIcon(QStyle::SP_DirIcon), text));
+        opLog->record(OpLog::AddNotebook, text);
+        libraryWatcher->announceStructureChanged();
         // Select the newly added notebook
         notebookListView->setCurrentIndex(notebookModel->index(notebookModel->rowCount() - 1, 0));
     }
@@ -427,6 +1054,9 @@ void MainWindow::addNotebook()
          }
 
          parentItem->appendRow(newItem);
+         opLog->record(OpLog::AddSection, PageHistory::keyFor({currentNotebookName, text}),
+                       parentItem == sectionModel->invisibleRootItem() ? QString() : parentItem->text());
+         libraryWatcher->announceStructureChanged();
          QModelIndex newIndex = sectionModel->indexFromItem(newItem);
          sectionTreeView->setCurrentIndex(newIndex);
          sectionTreeView->expand(newIndex.parent()); // Expand the parent
@@ -471,6 +1101,8 @@ void MainWindow::addNotebook()
 
          parentItem->appendRow(newItem);
          QModelIndex newIndex = pageModel->indexFromItem(newItem);
+         opLog->record(OpLog::AddPage, PageHistory::keyFor(pagePath(newIndex)));
+         libraryWatcher->announceStructureChanged();
          pageTreeView->setCurrentIndex(newIndex);
          pageTreeView->expand(newIndex.parent()); // Expand the parent
       }
@@ -520,6 +1152,11 @@ void MainWindow::addNotebook()
      contextMenu.addAction(addSubpageAction);
      promoteSubpageAction->setEnabled(isSubpage); // Can only promote if it's a subpage
      contextMenu.addAction(promoteSubpageAction);
+     if (onItem && index == pageTreeView->currentIndex()) { // Rename/History act on the open page
+         contextMenu.addSeparator();
+         contextMenu.addAction(renamePageAction);
+         contextMenu.addAction(pageHistoryAction);
+     }
 
      // Add Delete/Rename later
      // if (onItem) {
@@ -555,6 +1192,9 @@ void MainWindow::addNotebook()
          // newItem->setFlags(newItem->flags() & ~Qt::ItemIsEditable); // Prevent editing group name easily?
 
          sectionModel->invisibleRootItem()->appendRow(newItem);
+         opLog->record(OpLog::AddSectionGroup,
+                       PageHistory::keyFor({notebookModel->data(currentNotebookIndex).toString(), text}));
+         libraryWatcher->announceStructureChanged();
          sectionTreeView->setCurrentIndex(sectionModel->indexFromItem(newItem));
          sectionTreeView->expand(sectionModel->index(0,0).parent());
      }
@@ -583,6 +1223,8 @@ void MainWindow::addNotebook()
      if (ok && !text.isEmpty()) {
          QStandardItem *newItem = new QStandardItem(style()->standardIcon(QStyle::SP_FileIcon), text);
          parentItem->appendRow(newItem); // Append as child
+         opLog->record(OpLog::AddSubpage, PageHistory::keyFor(pagePath(pageModel->indexFromItem(newItem))));
+         libraryWatcher->announceStructureChanged();
          pageTreeView->expand(currentPageIndex); // Ensure parent is expanded
          pageTreeView->setCurrentIndex(pageModel->indexFromItem(newItem));
      }
@@ -609,6 +1251,27 @@ void MainWindow::addNotebook()
          grandparentItem = pageModel->invisibleRootItem();
      }
 
+     // Page paths double as history keys, so the promoted page must not clash
+     // with a page already at its new level
+     const QStringList oldPath = pagePath(currentSubpageIndex);
+     QStringList newPath = oldPath;
+     newPath.removeAt(newPath.size() - 2); // Drop the parent page from the chain
+     const QString oldKey = PageHistory::keyFor(oldPath);
+     const QString newKey = PageHistory::keyFor(newPath);
+     bool taken = pageHistory->hasPage(newKey);
+     for (int row = 0; row < grandparentItem->rowCount() && !taken; ++row)
+         taken = grandparentItem->child(row)->text() == subpageItem->text();
+     if (taken) {
+         QMessageBox::warning(this, tr("Promote Subpage"),
+                              tr("A page named '%1' already exists there.").arg(subpageItem->text()));
+         return;
+     }
+
+     // Move the saved history first: taking the row below changes the selection,
+     // and the reselected page must find its revisions under the new key
+     saveCurrentPage();
+     movePageHistory(oldKey, newKey);
+
      // Take the row from the original parent and append it to the new parent
      // takeRow returns a QList<QStandardItem*>, we expect only one item (our subpage)
      QList<QStandardItem*> row = parentItem->takeRow(currentSubpageIndex.row());
@@ -619,5 +1282,51 @@ void MainWindow::addNotebook()
      }
  }
 
+ void MainWindow::renamePage()
+ {
+     QModelIndex currentIndex = pageTreeView->currentIndex();
+     if (!currentIndex.isValid()) {
+         QMessageBox::warning(this, tr("Rename Page"), tr("Please select a page to rename."));
+         return;
+     }
+     QStandardItem *item = pageModel->itemFromIndex(currentIndex);
+     const QString oldTitle = item->text();
+
+     bool ok;
+     const QString newTitle = QInputDialog::getText(this, tr("Rename Page"),
+                                                    tr("Page name:"), QLineEdit::Normal,
+                                                    oldTitle, &ok).trimmed();
+     if (!ok || newTitle.isEmpty() || newTitle == oldTitle)
+         return;
+
+     // Page paths double as history keys, so siblings need distinct names
+     QStandardItem *parentItem = item->parent() ? item->parent() : pageModel->invisibleRootItem();
+     for (int row = 0; row < parentItem->rowCount(); ++row) {
+         if (parentItem->child(row) != item && parentItem->child(row)->text() == newTitle) {
+             QMessageBox::warning(this, tr("Rename Page"), tr("A page named '%1' already exists here.").arg(newTitle));
+             return;
+         }
+     }
+
+     saveCurrentPage();
+     QStringList newPath = pagePath(currentIndex);
+     newPath.last() = newTitle;
+     const QString newKey = PageHistory::keyFor(newPath);
+     const QString oldKey = currentPageKey;
+     movePageHistory(oldKey, newKey);
+     currentPageKey = newKey;
+     item->setText(newTitle);
+
+     const int updated = updateLinksAfterRename(oldKey, newTitle);
+     refreshBacklinks();
+     if (updated < 0) {
+         statusBar()->showMessage(tr("Renamed '%1' to '%2'; [[%1]] links were not changed because another page "
+                                     "is also called '%1'").arg(oldTitle, newTitle), 5000);
+     } else {
+         statusBar()->showMessage(tr("Renamed '%1' to '%2', updated links in %n page(s)", "", updated)
+                                      .arg(oldTitle, newTitle), 3000);
+     }
+ }
+
 
  // Make sure there are no stray characters after this final brace
@@ -0,0 +1,764 @@
+// src/OpLog.cpp
+#include "OpLog.h"
+#include "PageHistory.h"
+#include "BinaryDelta.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QBuffer>
+#include <QDataStream>
+#include <QLockFile>
+#include <QSaveFile>
+#include <QUuid>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+constexpr quint32 kFileMagic = 0x4e4f4c31; // "NOL1"
+constexpr quint16 kFileVersion = 1;
+constexpr quint32 kSizesMagic = 0x4e4c5331; // "NLS1"
+constexpr quint32 kStateMagic = 0x4e4f5331; // "NOS1"
+constexpr int kLockTimeoutMs = 2000;
+
+// One record: everything about an op, payload last
+void writeOp(QDataStream &out, const OpLog::Op &op, const QByteArray &payload)
+{
+    out << op.seq << op.lamport << quint8(op.type) << op.key << op.arg
+        << op.baseHash << op.resultHash << payload;
+}
+
+// Without 'payload' the payload bytes are skipped, not read: indexing only needs the rest
+bool readOp(QDataStream &in, OpLog::Op &op, QByteArray *payload)
+{
+    quint8 type = 0;
+    in >> op.seq >> op.lamport >> type >> op.key >> op.arg >> op.baseHash >> op.resultHash;
+    if (payload) {
+        in >> *payload;
+    } else {
+        quint32 size = 0; // How QDataStream writes a QByteArray: length (0xffffffff if null), then the bytes
+        in >> size;
+        if (in.status() == QDataStream::Ok && size != 0xffffffff && in.skipRawData(int(size)) != int(size))
+            in.setStatus(QDataStream::ReadPastEnd);
+    }
+    if (in.status() != QDataStream::Ok || type < OpLog::AddNotebook || type > OpLog::EditText)
+        return false;
+    op.type = OpLog::OpType(type);
+    return true;
+}
+
+void writeOrder(QDataStream &out, const OpLog::Order &order)
+{
+    out << order.lamport << order.replica << order.seq;
+}
+
+void readOrder(QDataStream &in, OpLog::Order &order)
+{
+    in >> order.lamport >> order.replica >> order.seq;
+}
+
+bool isSameOrSubpage(const QString &key, const QString &pageKey)
+{
+    return key == pageKey || key.startsWith(pageKey + PageHistory::keySeparator());
+}
+
+} // namespace
+
+OpLog::OpLog(const QString &directory)
+    : directoryPath(directory)
+{
+    QDir().mkpath(directoryPath);
+
+    // The replica id is created once per library and never changes
+    QFile idFile(QDir(directoryPath).filePath("replica.id"));
+    if (idFile.open(QIODevice::ReadOnly))
+        localReplica = QString::fromLatin1(idFile.readAll().trimmed());
+    if (localReplica.isEmpty()) {
+        localReplica = QUuid::createUuid().toString(QUuid::WithoutBraces);
+        QSaveFile newIdFile(idFile.fileName());
+        if (newIdFile.open(QIODevice::WriteOnly)) {
+            newIdFile.write(localReplica.toLatin1());
+            newIdFile.commit();
+        }
+    }
+
+    loadState(); // Ops it covers are not read again
+    refresh();
+    loggedSizes = readLoggedSizes();
+}
+
+QHash<QString, quint64> OpLog::versionVector() const
+{
+    QHash<QString, quint64> vector;
+    for (auto it = replicas.cbegin(); it != replicas.cend(); ++it)
+        vector.insert(it.key(), it.value().count());
+    return vector;
+}
+
+bool OpLog::findOp(const QString &id, Op &op)
+{
+    const qsizetype colon = id.lastIndexOf(QLatin1Char(':'));
+    const QString replica = id.left(colon);
+    const quint64 seq = id.mid(colon + 1).toULongLong();
+    if (colon < 0 || seq == 0 || seq > replicas.value(replica).count())
+        return false;
+    if (seq <= replicas.value(replica).baseSeq && !indexAll(replica))
+        return false;
+    const ReplicaFile &entry = replicas[replica];
+    const qsizetype index = qsizetype(seq - entry.baseSeq) - 1;
+    if (index < 0 || index >= entry.ops.size())
+        return false;
+    op = entry.ops[index];
+    return true;
+}
+
+void OpLog::setLoggedSize(const QString &key, qint64 size)
+{
+    if (loggedSizes.value(key, -1) == size) return;
+    loggedSizes.insert(key, size);
+    changedSizes.insert(key);
+}
+
+bool OpLog::saveLoggedSizes()
+{
+    if (changedSizes.isEmpty()) return true;
+
+    // Other instances of this library save theirs too: keep their entries
+    const QString fileName = QDir(directoryPath).filePath("logged.idx");
+    QLockFile lock(fileName + ".lock");
+    if (!lock.tryLock(kLockTimeoutMs))
+        return false;
+    QHash<QString, qint64> merged = readLoggedSizes();
+    for (const QString &key : std::as_const(changedSizes))
+        merged.insert(key, loggedSizes.value(key));
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kSizesMagic << kFileVersion << merged;
+    if (out.status() != QDataStream::Ok || !file.commit())
+        return false;
+    changedSizes.clear();
+    return true;
+}
+
+QHash<QString, qint64> OpLog::readLoggedSizes() const
+{
+    QHash<QString, qint64> sizes;
+    QFile file(QDir(directoryPath).filePath("logged.idx"));
+    if (!file.open(QIODevice::ReadOnly))
+        return sizes;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version >> sizes;
+    if (in.status() != QDataStream::Ok || magic != kSizesMagic || version != kFileVersion)
+        sizes.clear();
+    return sizes;
+}
+
+// Any snapshot is a consistent state of the append-only files, so instances
+// sharing the library can each save theirs; the last one written is loaded
+bool OpLog::saveState()
+{
+    if (!stateDirty) return true;
+    structure(); // A snapshot must cover every indexed op
+
+    QSaveFile file(stateFileName());
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kStateMagic << kFileVersion << quint32(replicas.size());
+    for (auto it = replicas.cbegin(); it != replicas.cend(); ++it)
+        out << it.key() << it.value().headerSize << it.value().count() << knownEnd(it.key());
+    out << lamportClock;
+    writeOrder(out, lastApplied);
+    writeOrder(out, lastMove);
+    replayed.save(out);
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        qWarning() << "Could not save" << file.fileName();
+        return false;
+    }
+    stateDirty = false;
+    return true;
+}
+
+bool OpLog::loadState()
+{
+    QFile file(stateFileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (in.status() != QDataStream::Ok || magic != kStateMagic || version != kFileVersion)
+        return false;
+
+    QHash<QString, ReplicaFile> files;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString replica;
+        ReplicaFile entry;
+        in >> replica >> entry.headerSize >> entry.baseSeq >> entry.baseEnd;
+        // The files only grow, so a shorter one means the state is not about it
+        if (entry.headerSize <= 0 || QFileInfo(fileNameFor(replica)).size() < entry.baseEnd)
+            return false;
+        files.insert(replica, entry);
+    }
+    quint64 clock = 0;
+    Order applied;
+    Order move;
+    Structure structure;
+    in >> clock;
+    readOrder(in, applied);
+    readOrder(in, move);
+    if (in.status() != QDataStream::Ok || !structure.load(in))
+        return false;
+
+    replicas = files;
+    lamportClock = clock;
+    lastApplied = applied;
+    lastMove = move;
+    replayed = structure;
+    replayValid = true;
+    stateDirty = false;
+    return true;
+}
+
+bool OpLog::record(OpType type, const QString &key, const QString &arg)
+{
+    Op op;
+    op.type = type;
+    op.key = key;
+    op.arg = arg;
+    return append(op, QByteArray());
+}
+
+bool OpLog::recordText(const QString &key, const QString &previous, const QString &text)
+{
+    const QByteArray before = previous.toUtf8();
+    const QByteArray after = text.toUtf8();
+
+    Op op;
+    op.type = EditText;
+    op.key = key;
+    op.resultHash = PageHistory::contentHash(after);
+
+    // A delta only helps if the other side is sure to have the base text
+    const quint64 beforeHash = PageHistory::contentHash(before);
+    if (!before.isEmpty() && hasResult(key, beforeHash)) {
+        op.baseHash = beforeHash;
+        return append(op, BinaryDelta::encode(before, after));
+    }
+    return append(op, BinaryDelta::encode(QByteArray(), after));
+}
+
+QByteArray OpLog::payload(const Op &op) const
+{
+    QFile file(fileNameFor(op.replica));
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(op.offset))
+        return QByteArray();
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    Op stored;
+    QByteArray data;
+    if (!readOp(in, stored, &data) || stored.seq != op.seq)
+        return QByteArray();
+    return data;
+}
+
+const OpLog::Structure &OpLog::structure()
+{
+    if (!replayValid)
+        replay();
+    return replayed;
+}
+
+// Replay every op from scratch; needs the ops the saved state covered too
+void OpLog::replay()
+{
+    const QStringList files = replicas.keys();
+    for (const QString &replica : files)
+        indexAll(replica);
+
+    QList<Op> all;
+    for (auto it = replicas.cbegin(); it != replicas.cend(); ++it)
+        all.append(it.value().ops);
+    std::sort(all.begin(), all.end(), [](const Op &a, const Op &b) {
+        if (a.lamport != b.lamport) return a.lamport < b.lamport;
+        if (a.replica != b.replica) return a.replica < b.replica;
+        return a.seq < b.seq;
+    });
+
+    replayed = Structure();
+    lastApplied = Order();
+    lastMove = Order();
+    for (const Op &op : std::as_const(all)) {
+        replayed.apply(op);
+        if (op.type == MovePage)
+            lastMove = op.order();
+    }
+    if (!all.isEmpty())
+        lastApplied = all.last().order();
+    replayValid = true;
+    stateDirty = true;
+}
+
+// Bring the structure up to date with one newly read or written op. Ops that
+// sort after everything applied so far (all local ones, and most synced ones)
+// are applied in place.
+void OpLog::indexOp(const Op &op)
+{
+    lamportClock = qMax(lamportClock, op.lamport);
+    if (!replayValid)
+        return;
+    stateDirty = true;
+
+    const Order order = op.order();
+    if (lastApplied < order) {
+        replayed.apply(op);
+        lastApplied = order;
+        if (op.type == MovePage)
+            lastMove = order;
+        return;
+    }
+    // An op from another replica that sorts before ops already applied. Adding
+    // a page and editing text give the same result now as in replay order as
+    // long as no page moved after them; anything else replays from scratch.
+    const bool commutes = op.type == AddPage || op.type == AddSubpage || op.type == EditText;
+    if (commutes && lastMove < order)
+        replayed.apply(op);
+    else
+        replayValid = false;
+}
+
+void OpLog::Structure::apply(const Op &op)
+{
+    const QStringList path = PageHistory::pathFor(op.key);
+    switch (op.type) {
+    case AddNotebook:
+        ensureNotebook(op.key);
+        break;
+    case AddSectionGroup:
+        if (path.size() == 2) {
+            ensureNotebook(path[0]);
+            if (!groupSet[path[0]].contains(path[1])) {
+                groupSet[path[0]].insert(path[1]);
+                sectionGroups[path[0]].append(path[1]);
+            }
+        }
+        break;
+    case AddSection:
+        if (path.size() == 2)
+            ensureSection(path[0], path[1], op.arg);
+        break;
+    case AddPage:
+    case AddSubpage:
+        if (path.size() >= 3)
+            nodeFor(op.type == AddSubpage ? currentChildKey(op.key) : op.key);
+        break;
+    case MovePage: {
+        if (path.size() < 3 || PageHistory::pathFor(op.arg).size() < 3)
+            break;
+        const QString from = currentKey(op.key);
+        const QString to = currentChildKey(op.arg);
+        // Moving onto an existing page loses, the same way on every replica
+        if (from == to || nodeAt.contains(to))
+            break;
+        QList<QPair<QString, int>> moving;
+        for (auto it = nodeAt.cbegin(); it != nodeAt.cend(); ++it) {
+            if (isSameOrSubpage(it.key(), from))
+                moving.append({it.key(), it.value()});
+        }
+        if (moving.isEmpty()) {
+            nodeFor(to); // A page that was never recorded (e.g. sample content) still shows up
+            break;
+        }
+        for (const auto &entry : moving)
+            nodeAt.remove(entry.first);
+        for (const auto &entry : moving) {
+            const QString newKey = to + entry.first.mid(from.size());
+            nodeKeys[entry.second] = newKey;
+            nodeAt.insert(newKey, entry.second);
+            aliases.insert(entry.first, entry.second);
+        }
+        break;
+    }
+    case EditText:
+        if (path.size() >= 3) {
+            const int node = nodeFor(currentKey(op.key));
+            textNodes.insert(op.id(), node);
+            // Later in replay order wins, also when the earlier one is applied last
+            auto winner = winners.constFind(node);
+            if (winner == winners.cend() || winner.value().order < op.order())
+                winners.insert(node, {op.resultHash, op.order()});
+            results[node].insert(op.resultHash);
+        }
+        break;
+    }
+}
+
+void OpLog::Structure::ensureNotebook(const QString &notebook)
+{
+    if (!notebookSet.contains(notebook)) {
+        notebookSet.insert(notebook);
+        notebooks.append(notebook);
+    }
+}
+
+void OpLog::Structure::ensureSection(const QString &notebook, const QString &section, const QString &group)
+{
+    ensureNotebook(notebook);
+    if (!sectionSet[notebook].contains(section)) {
+        sectionSet[notebook].insert(section);
+        sections[notebook].append({section, group});
+    }
+}
+
+int OpLog::Structure::nodeFor(const QString &key)
+{
+    auto it = nodeAt.constFind(key);
+    if (it != nodeAt.constEnd())
+        return it.value();
+    const QStringList path = PageHistory::pathFor(key);
+    if (path.size() >= 2)
+        ensureSection(path[0], path[1], QString());
+    const int node = nodeKeys.size();
+    nodeKeys.append(key);
+    nodeAt.insert(key, node);
+    return node;
+}
+
+// Where 'key' is now: the deepest page on its path that exists under that
+// key stays put, the deepest one that was moved away takes the rest along
+QString OpLog::Structure::currentKey(const QString &key) const
+{
+    const QStringList path = PageHistory::pathFor(key);
+    for (int size = path.size(); size >= 3; --size) {
+        const QString prefix = PageHistory::keyFor(path.mid(0, size));
+        if (nodeAt.contains(prefix))
+            return key;
+        auto alias = aliases.constFind(prefix);
+        if (alias != aliases.cend())
+            return nodeKeys[alias.value()] + key.mid(prefix.size());
+    }
+    return key;
+}
+
+// A subpage belongs under wherever its parent page is now
+QString OpLog::Structure::currentChildKey(const QString &key) const
+{
+    const QStringList path = PageHistory::pathFor(key);
+    if (path.size() <= 3)
+        return key;
+    return currentKey(PageHistory::keyFor(path.mid(0, path.size() - 1))) + PageHistory::keySeparator() + path.last();
+}
+
+QString OpLog::Structure::finalKey(const QString &key) const
+{
+    auto alias = aliases.constFind(key);
+    if (alias == aliases.cend() || nodeAt.contains(key)) // Taken over by another page since
+        return QString();
+    return nodeKeys[alias.value()];
+}
+
+QString OpLog::Structure::textTarget(const QString &opId) const
+{
+    auto node = textNodes.constFind(opId);
+    return node == textNodes.cend() ? QString() : nodeKeys[node.value()];
+}
+
+quint64 OpLog::Structure::textWinner(const QString &key) const
+{
+    auto node = nodeAt.constFind(key);
+    return node == nodeAt.cend() ? 0 : winners.value(node.value()).hash;
+}
+
+bool OpLog::Structure::hasResult(const QString &key, quint64 hash) const
+{
+    auto node = nodeAt.constFind(key);
+    return node != nodeAt.cend() && results.value(node.value()).contains(hash);
+}
+
+void OpLog::Structure::save(QDataStream &out) const
+{
+    out << notebooks << sectionGroups << sections << nodeKeys << nodeAt << aliases << results << textNodes;
+    out << quint32(winners.size());
+    for (auto it = winners.cbegin(); it != winners.cend(); ++it) {
+        out << qint32(it.key()) << it.value().hash;
+        writeOrder(out, it.value().order);
+    }
+}
+
+bool OpLog::Structure::load(QDataStream &in)
+{
+    in >> notebooks >> sectionGroups >> sections >> nodeKeys >> nodeAt >> aliases >> results >> textNodes;
+    quint32 count = 0;
+    in >> count;
+    winners.clear();
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        qint32 node = 0;
+        Winner winner;
+        in >> node >> winner.hash;
+        readOrder(in, winner.order);
+        winners.insert(node, winner);
+    }
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    // The lookup sets follow from the lists
+    notebookSet = QSet<QString>(notebooks.cbegin(), notebooks.cend());
+    groupSet.clear();
+    for (auto it = sectionGroups.cbegin(); it != sectionGroups.cend(); ++it)
+        groupSet.insert(it.key(), QSet<QString>(it.value().cbegin(), it.value().cend()));
+    sectionSet.clear();
+    for (auto it = sections.cbegin(); it != sections.cend(); ++it) {
+        for (const auto &section : it.value())
+            sectionSet[it.key()].insert(section.first);
+    }
+    return true;
+}
+
+QByteArray OpLog::rawOps(const QString &replica, quint64 afterSeq)
+{
+    if (afterSeq >= replicas.value(replica).count())
+        return QByteArray();
+    // Sending from where the saved state ends needs no index of the older ops
+    if (afterSeq < replicas.value(replica).baseSeq && !indexAll(replica))
+        return QByteArray();
+
+    const ReplicaFile &entry = replicas[replica];
+    qint64 from = 0;
+    if (afterSeq == entry.baseSeq && entry.baseSeq > 0) {
+        from = entry.baseEnd;
+    } else {
+        const qsizetype index = qsizetype(afterSeq - entry.baseSeq);
+        if (index < 0 || index >= entry.ops.size())
+            return QByteArray();
+        from = entry.ops[index].offset;
+    }
+    const qint64 to = knownEnd(replica);
+    QFile file(fileNameFor(replica));
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(from))
+        return QByteArray();
+    return file.read(to - from);
+}
+
+QList<OpLog::Op> OpLog::appendRaw(const QString &replica, const QByteArray &records)
+{
+    QList<Op> added;
+    if (records.isEmpty() || replica.isEmpty()) return added;
+
+    const QString fileName = fileNameFor(replica);
+    QLockFile lock(fileName + ".lock");
+    if (!lock.tryLock(kLockTimeoutMs)) {
+        qWarning() << "Could not lock" << fileName;
+        return added;
+    }
+    if (QFile::exists(fileName))
+        loadFile(replica);
+    const quint64 before = replicas.value(replica).count();
+
+    // Keep only the records we do not have yet, and check they continue our copy
+    QBuffer buffer;
+    buffer.setData(records);
+    buffer.open(QIODevice::ReadOnly);
+    QDataStream in(&buffer);
+    in.setVersion(QDataStream::Qt_6_0);
+    qint64 keepFrom = -1;
+    quint64 expected = before + 1;
+    while (!buffer.atEnd()) {
+        const qint64 start = buffer.pos();
+        Op op;
+        if (!readOp(in, op, nullptr)) {
+            qWarning() << "Corrupt ops received for replica" << replica;
+            return added;
+        }
+        if (op.seq < expected)
+            continue; // Already have it
+        if (op.seq != expected) {
+            qWarning() << "Gap in ops received for replica" << replica << "at" << op.seq;
+            return added;
+        }
+        if (keepFrom < 0)
+            keepFrom = start;
+        ++expected;
+    }
+    if (keepFrom < 0)
+        return added;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "Could not open" << fileName << file.errorString();
+        return added;
+    }
+    if (!replicas.contains(replica)) {
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << kFileMagic << kFileVersion << replica;
+        replicas[replica].headerSize = file.pos();
+    }
+    const qint64 end = knownEnd(replica);
+    if (file.size() != end)
+        file.resize(end); // Torn tail from an interrupted write
+    file.seek(end);
+    file.write(records.mid(keepFrom));
+    file.close();
+
+    loadFile(replica);
+    const ReplicaFile &entry = replicas[replica];
+    for (qsizetype i = qsizetype(before - entry.baseSeq); i < entry.ops.size(); ++i)
+        added.append(entry.ops[i]);
+    return added;
+}
+
+void OpLog::refresh()
+{
+    const QStringList files = QDir(directoryPath).entryList(QStringList{"*.ops"}, QDir::Files);
+    for (const QString &file : files)
+        loadFile(QFileInfo(file).completeBaseName());
+}
+
+bool OpLog::append(Op op, const QByteArray &payload)
+{
+    const QString fileName = fileNameFor(localReplica);
+    QLockFile lock(fileName + ".lock");
+    if (!lock.tryLock(kLockTimeoutMs)) {
+        qWarning() << "Could not lock" << fileName;
+        return false;
+    }
+    refresh(); // Other instances of this library may have appended, and synced ops move the clock
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "Could not open" << fileName << file.errorString();
+        return false;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    if (!replicas.contains(localReplica)) {
+        out << kFileMagic << kFileVersion << localReplica;
+        replicas[localReplica].headerSize = file.pos();
+    }
+    const qint64 end = knownEnd(localReplica);
+    if (file.size() != end)
+        file.resize(end); // Torn tail from an interrupted write
+    file.seek(end);
+
+    op.replica = localReplica;
+    op.seq = replicas[localReplica].count() + 1;
+    op.lamport = lamportClock + 1;
+    op.offset = end;
+    writeOp(out, op, payload);
+    if (out.status() != QDataStream::Ok || !file.flush()) {
+        qWarning() << "Could not write" << fileName;
+        return false;
+    }
+    op.size = file.pos() - op.offset;
+
+    replicas[localReplica].ops.append(op);
+    indexOp(op);
+    return true;
+}
+
+QString OpLog::fileNameFor(const QString &replica) const
+{
+    return QDir(directoryPath).filePath(replica + ".ops");
+}
+
+QString OpLog::stateFileName() const
+{
+    return QDir(directoryPath).filePath("state.idx");
+}
+
+qint64 OpLog::knownEnd(const QString &replica) const
+{
+    auto it = replicas.constFind(replica);
+    if (it == replicas.cend())
+        return 0;
+    if (!it->ops.isEmpty())
+        return it->ops.last().offset + it->ops.last().size;
+    return it->baseSeq > 0 ? it->baseEnd : it->headerSize;
+}
+
+// Index the ops the saved state covered (payloads skipped). If the file does
+// not match the state, it is read again from the start and replayed.
+bool OpLog::indexAll(const QString &replica)
+{
+    ReplicaFile &entry = replicas[replica];
+    if (entry.baseSeq == 0)
+        return true;
+
+    QFile file(fileNameFor(replica));
+    QVector<Op> older;
+    if (file.open(QIODevice::ReadOnly) && file.seek(entry.headerSize)) {
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_6_0);
+        older.reserve(qsizetype(entry.baseSeq));
+        while (quint64(older.size()) < entry.baseSeq) {
+            Op op;
+            op.offset = file.pos();
+            if (!readOp(in, op, nullptr) || op.seq != quint64(older.size()) + 1)
+                break;
+            op.replica = replica;
+            op.size = file.pos() - op.offset;
+            older.append(op);
+        }
+    }
+    if (quint64(older.size()) != entry.baseSeq || older.last().offset + older.last().size != entry.baseEnd) {
+        qWarning() << "Op log state does not match" << file.fileName() << "- reading it again";
+        entry.ops.clear();
+        entry.baseSeq = 0;
+        entry.baseEnd = 0;
+        replayValid = false;
+        return loadFile(replica);
+    }
+    older.append(entry.ops);
+    entry.ops = older;
+    entry.baseSeq = 0;
+    entry.baseEnd = 0;
+    return true;
+}
+
+bool OpLog::loadFile(const QString &replica)
+{
+    QFile file(fileNameFor(replica));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    if (!replicas.contains(replica)) {
+        quint32 magic = 0;
+        quint16 version = 0;
+        QString storedReplica;
+        in >> magic >> version >> storedReplica;
+        if (in.status() != QDataStream::Ok || magic != kFileMagic || version != kFileVersion
+            || storedReplica != replica) {
+            return false; // Not ours, or its header is still being written
+        }
+        replicas[replica].headerSize = file.pos();
+    }
+    if (!file.seek(knownEnd(replica)))
+        return false;
+
+    ReplicaFile &entry = replicas[replica];
+    while (!file.atEnd()) {
+        Op op;
+        op.offset = file.pos();
+        if (!readOp(in, op, nullptr) || op.seq != entry.count() + 1)
+            break; // Torn tail (or a write in progress)
+        op.replica = replica;
+        op.size = file.pos() - op.offset;
+        entry.ops.append(op);
+        indexOp(op);
+    }
+    return true;
+}
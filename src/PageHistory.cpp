@@ -0,0 +1,483 @@
+// src/PageHistory.cpp
+#include "PageHistory.h"
+#include "BinaryDelta.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QLockFile>
+#include <QSet>
+#include <QCryptographicHash>
+#include <QDebug>
+
+namespace {
+
+constexpr quint32 kFileMagic = 0x4e504831; // "NPH1"
+constexpr quint16 kFileVersion = 1;
+constexpr quint8 kKeyframeRecord = 0;
+constexpr quint8 kDeltaRecord = 1;
+const QChar kKeySeparator(0x1f); // Unit separator, never typed into a title
+// Writers hold a lock per page file; saves are quick, so waiting is rare and short
+constexpr int kLockTimeoutMs = 2000;
+
+} // namespace
+
+PageHistory::PageHistory(const QString &directory)
+    : directoryPath(directory)
+{
+    QDir().mkpath(directoryPath);
+
+    // Only read the headers here; revision indexes are loaded on first use
+    const QStringList files = QDir(directoryPath).entryList(QStringList{"*.nph"}, QDir::Files);
+    for (const QString &file : files) {
+        Entry entry;
+        entry.fileName = QDir(directoryPath).filePath(file);
+        QString key;
+        if (readHeader(entry.fileName, key, entry.headerSize)) {
+            entry.fileSize = QFileInfo(entry.fileName).size();
+            entries.insert(key, entry);
+        }
+        else
+            qWarning() << "Skipping unreadable history file" << entry.fileName;
+    }
+}
+
+QString PageHistory::keyFor(const QStringList &path)
+{
+    return path.join(kKeySeparator);
+}
+
+QStringList PageHistory::pathFor(const QString &key)
+{
+    return key.split(kKeySeparator);
+}
+
+QChar PageHistory::keySeparator()
+{
+    return kKeySeparator;
+}
+
+quint64 PageHistory::contentHash(const QByteArray &utf8)
+{
+    quint64 hash = 14695981039346656037ULL;
+    for (char c : utf8) {
+        hash ^= quint8(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+int PageHistory::revisionCount(const QString &key)
+{
+    Entry *entry = loadedEntry(key);
+    return entry ? entry->revisions.size() : 0;
+}
+
+QDateTime PageHistory::revisionTime(const QString &key, int revision)
+{
+    Entry *entry = loadedEntry(key);
+    if (!entry || revision < 0 || revision >= entry->revisions.size())
+        return QDateTime();
+    return QDateTime::fromMSecsSinceEpoch(entry->revisions[revision].time);
+}
+
+QString PageHistory::revisionText(const QString &key, int revision)
+{
+    QString text;
+    readRevision(key, revision, text);
+    return text;
+}
+
+bool PageHistory::readRevision(const QString &key, int revision, QString &text)
+{
+    text.clear();
+    Entry *entry = loadedEntry(key);
+    if (!entry || revision < 0 || revision >= entry->revisions.size())
+        return false;
+
+    QByteArray content;
+    if (!rebuild(*entry, revision, content))
+        return false;
+    text = QString::fromUtf8(content);
+    return true;
+}
+
+quint64 PageHistory::revisionHash(const QString &key, int revision)
+{
+    Entry *entry = loadedEntry(key);
+    if (!entry || revision < 0 || revision >= entry->revisions.size())
+        return 0;
+    return entry->revisions[revision].hash;
+}
+
+int PageHistory::findRevision(const QString &key, quint64 hash)
+{
+    Entry *entry = loadedEntry(key);
+    if (!entry) return -1;
+    for (int revision = entry->revisions.size() - 1; revision >= 0; --revision) {
+        if (entry->revisions[revision].hash == hash)
+            return revision;
+    }
+    return -1;
+}
+
+QString PageHistory::latestText(const QString &key)
+{
+    return revisionText(key, revisionCount(key) - 1);
+}
+
+int PageHistory::saveRevision(const QString &key, const QString &text)
+{
+    Entry *entry = loadedEntry(key);
+    if (!entry && entries.contains(key)) {
+        // Known page whose file could not be read
+        if (QFile::exists(entries.value(key).fileName))
+            return SaveFailed;
+        entries.remove(key);
+        return PageMoved;
+    }
+    if (!entry) {
+        // First revision of a new page
+        Entry created;
+        created.fileName = fileNameFor(key);
+        created.loaded = true;
+        entry = &entries.insert(key, created).value();
+    }
+
+    // Other app instances may write this page too: hold its lock and pick up
+    // anything they appended, so the delta is taken against the real latest
+    QLockFile lock(entry->fileName + ".lock");
+    if (!lock.tryLock(kLockTimeoutMs)) {
+        qWarning() << "History file is locked by another instance" << entry->fileName;
+        return SaveFailed;
+    }
+    if (entry->headerSize == 0 && QFile::exists(entry->fileName)) {
+        QString storedKey;
+        readHeader(entry->fileName, storedKey, entry->headerSize); // Created elsewhere meanwhile
+    } else if (entry->headerSize > 0) {
+        // Writing on after the page was moved away would recreate a headerless file
+        QString storedKey;
+        qint64 headerSize = 0;
+        const bool readable = readHeader(entry->fileName, storedKey, headerSize);
+        if (!readable && QFile::exists(entry->fileName))
+            return SaveFailed;
+        if (!readable || storedKey != key || QFileInfo(entry->fileName).size() < entry->fileSize) {
+            entries.remove(key);
+            return PageMoved;
+        }
+    }
+    if (entry->headerSize > 0 && !loadRevisions(*entry))
+        return SaveFailed;
+
+    const QByteArray content = text.toUtf8();
+    const int last = entry->revisions.size() - 1;
+    if (last >= 0 && !entry->latestValid && !rebuild(*entry, last, entry->latest))
+        return SaveFailed;
+    if (last >= 0 && entry->latest == content)
+        return Unchanged;
+
+    // Delta against the previous revision unless a keyframe is now cheaper,
+    // to store or to rebuild (every delta in the chain copies the whole page)
+    QByteArray payload;
+    bool keyframe = last < 0 || entry->chainLength + 1 >= kMaxChainLength
+        || (entry->chainLength + 1) * qMax<qint64>(content.size(), entry->latest.size()) > kMaxRebuildBytes;
+    if (!keyframe) {
+        payload = BinaryDelta::encode(entry->latest, content);
+        keyframe = entry->chainBytes + payload.size() > entry->keyframeBytes;
+    }
+    if (keyframe)
+        payload = qCompress(content);
+
+    QFile file(entry->fileName);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "Could not open history file" << entry->fileName << file.errorString();
+        return SaveFailed;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    if (entry->headerSize == 0) {
+        out << kFileMagic << kFileVersion << key;
+        entry->headerSize = file.pos();
+    }
+    // Drop a torn record left behind by a crash before appending (safe under the lock)
+    const qint64 validEnd = entry->revisions.isEmpty()
+        ? entry->headerSize
+        : entry->revisions.last().offset + entry->revisions.last().size;
+    if (file.size() != validEnd)
+        file.resize(validEnd);
+    file.seek(validEnd);
+
+    Revision revision;
+    revision.offset = validEnd;
+    revision.time = QDateTime::currentMSecsSinceEpoch();
+    revision.hash = contentHash(content);
+    revision.keyframe = keyframe;
+    out << (keyframe ? kKeyframeRecord : kDeltaRecord) << revision.time << revision.hash << payload;
+    if (out.status() != QDataStream::Ok || !file.flush()) {
+        qWarning() << "Could not write history file" << entry->fileName;
+        return SaveFailed;
+    }
+    revision.size = file.pos() - revision.offset;
+    entry->fileSize = file.pos();
+
+    entry->revisions.append(revision);
+    entry->latest = content;
+    entry->latestValid = true;
+    if (keyframe) {
+        entry->chainLength = 0;
+        entry->chainBytes = 0;
+        entry->keyframeBytes = payload.size();
+    } else {
+        entry->chainLength++;
+        entry->chainBytes += payload.size();
+    }
+    return entry->revisions.size() - 1;
+}
+
+QList<QPair<QString, QString>> PageHistory::movePages(const QString &oldKey, const QString &newKey)
+{
+    QList<QPair<QString, QString>> moved;
+    if (oldKey == newKey) return moved;
+
+    const QString childPrefix = oldKey + kKeySeparator;
+    const QStringList keys = entries.keys();
+    for (const QString &key : keys) {
+        if (key != oldKey && !key.startsWith(childPrefix))
+            continue;
+        const QString targetKey = newKey + key.mid(oldKey.size());
+        if (entries.contains(targetKey)) {
+            qWarning() << "Not moving history onto existing page" << pathFor(targetKey);
+            continue;
+        }
+
+        // Rewrite the file with the new key in its header; records are copied as-is
+        const Entry source = entries.value(key);
+        const QString targetFileName = fileNameFor(targetKey);
+        QLockFile sourceLock(source.fileName + ".lock");
+        QLockFile targetLock(targetFileName + ".lock");
+        if (!sourceLock.tryLock(kLockTimeoutMs) || !targetLock.tryLock(kLockTimeoutMs)) {
+            qWarning() << "Could not lock history of" << pathFor(key) << "for moving";
+            continue;
+        }
+        if (QFile::exists(targetFileName)) {
+            qWarning() << "Not moving history onto existing page" << pathFor(targetKey);
+            continue; // Another instance got there first
+        }
+        QFile in(source.fileName);
+        if (!in.open(QIODevice::ReadOnly) || !in.seek(source.headerSize))
+            continue;
+        const QByteArray records = in.readAll();
+        in.close();
+
+        Entry target;
+        target.fileName = targetFileName;
+        QFile out(target.fileName);
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            continue;
+        QDataStream stream(&out);
+        stream.setVersion(QDataStream::Qt_6_0);
+        stream << kFileMagic << kFileVersion << targetKey;
+        target.headerSize = out.pos();
+        out.write(records);
+        if (!out.flush()) {
+            out.remove();
+            continue;
+        }
+        target.fileSize = out.pos();
+        out.close();
+
+        QFile::remove(source.fileName);
+        entries.remove(key);
+        entries.insert(targetKey, target);
+        moved.append({key, targetKey});
+    }
+    return moved;
+}
+
+QString PageHistory::fileNameFor(const QString &key) const
+{
+    const QByteArray digest = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QDir(directoryPath).filePath(QString::fromLatin1(digest) + ".nph");
+}
+
+bool PageHistory::readHeader(const QString &fileName, QString &key, qint64 &headerSize) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version >> key;
+    if (in.status() != QDataStream::Ok || magic != kFileMagic || version != kFileVersion)
+        return false;
+    headerSize = file.pos();
+    return true;
+}
+
+PageHistory::Entry *PageHistory::loadedEntry(const QString &key)
+{
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return nullptr;
+    if (!it->loaded && !loadRevisions(*it))
+        return nullptr;
+    return &it.value();
+}
+
+// Reads the records after the last known one (all of them on first load)
+bool PageHistory::loadRevisions(Entry &entry)
+{
+    const qint64 knownEnd = entry.revisions.isEmpty()
+        ? entry.headerSize
+        : entry.revisions.last().offset + entry.revisions.last().size;
+    QFile file(entry.fileName);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(knownEnd))
+        return false;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    const int known = entry.revisions.size();
+    while (!file.atEnd()) {
+        Revision revision;
+        revision.offset = file.pos();
+        quint8 kind = 0;
+        QByteArray payload;
+        in >> kind >> revision.time >> revision.hash >> payload;
+        if (in.status() != QDataStream::Ok)
+            break; // Torn tail (crash, or a write still in progress); ignored for now
+        revision.size = file.pos() - revision.offset;
+        revision.keyframe = kind == kKeyframeRecord;
+        entry.revisions.append(revision);
+
+        // Track where the current delta chain stands, measured the same way saveRevision() does
+        if (revision.keyframe) {
+            entry.chainLength = 0;
+            entry.chainBytes = 0;
+            entry.keyframeBytes = payload.size();
+        } else {
+            entry.chainLength++;
+            entry.chainBytes += payload.size();
+        }
+    }
+
+    if (entry.revisions.size() != known)
+        entry.latestValid = false;
+    entry.fileSize = file.size();
+    entry.loaded = true;
+    return true;
+}
+
+bool PageHistory::refreshPage(const QString &key)
+{
+    auto it = entries.find(key);
+    const QString fileName = it != entries.end() ? it->fileName : fileNameFor(key);
+    const QFileInfo info(fileName);
+
+    if (!info.exists()) {
+        // Moved away by another instance
+        if (it == entries.end()) return false;
+        entries.erase(it);
+        return true;
+    }
+    if (it == entries.end()) {
+        // Created by another instance
+        Entry entry;
+        entry.fileName = fileName;
+        QString storedKey;
+        if (!readHeader(fileName, storedKey, entry.headerSize) || storedKey != key)
+            return false;
+        entry.fileSize = info.size();
+        entries.insert(key, entry);
+        return true;
+    }
+    if (info.size() == it->fileSize)
+        return false;
+
+    // Appended to by another instance: read just the new records
+    it->fileSize = info.size();
+    if (it->loaded)
+        loadRevisions(*it);
+    return true;
+}
+
+QStringList PageHistory::refresh()
+{
+    QStringList changed;
+    QSet<QString> knownFiles;
+    const QStringList keys = entries.keys();
+    for (const QString &key : keys) {
+        knownFiles.insert(QFileInfo(entries.value(key).fileName).fileName());
+        if (refreshPage(key))
+            changed.append(key);
+    }
+
+    const QStringList files = QDir(directoryPath).entryList(QStringList{"*.nph"}, QDir::Files);
+    for (const QString &file : files) {
+        if (knownFiles.contains(file))
+            continue;
+        Entry entry;
+        entry.fileName = QDir(directoryPath).filePath(file);
+        QString key;
+        if (!readHeader(entry.fileName, key, entry.headerSize))
+            continue; // Possibly still being written; the next notification picks it up
+        entry.fileSize = QFileInfo(entry.fileName).size();
+        entries.insert(key, entry);
+        changed.append(key);
+    }
+    return changed;
+}
+
+bool PageHistory::rebuild(Entry &entry, int revision, QByteArray &out)
+{
+    const int last = entry.revisions.size() - 1;
+    if (revision == last && entry.latestValid) {
+        out = entry.latest;
+        return true;
+    }
+
+    // Walk back to the keyframe, then replay the deltas forward
+    int keyframe = revision;
+    while (keyframe > 0 && !entry.revisions[keyframe].keyframe)
+        --keyframe;
+    if (!entry.revisions[keyframe].keyframe)
+        return false;
+
+    QFile file(entry.fileName);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(entry.revisions[keyframe].offset))
+        return false;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    QByteArray content;
+    QByteArray next;
+    for (int i = keyframe; i <= revision; ++i) {
+        quint8 kind = 0;
+        qint64 time = 0;
+        quint64 hash = 0;
+        QByteArray payload;
+        in >> kind >> time >> hash >> payload;
+        if (in.status() != QDataStream::Ok)
+            return false;
+        if (i == keyframe) {
+            content = qUncompress(payload);
+        } else {
+            if (!BinaryDelta::apply(content, payload, next))
+                return false;
+            content.swap(next);
+        }
+    }
+
+    if (contentHash(content) != entry.revisions[revision].hash) {
+        qWarning() << "History revision" << revision << "of" << entry.fileName << "failed its checksum";
+        return false;
+    }
+    if (revision == last) {
+        entry.latest = content;
+        entry.latestValid = true;
+    }
+    out = content;
+    return true;
+}
@@ -0,0 +1,142 @@
+// src/TextMerge.cpp
+#include "TextMerge.h"
+
+#include <QStringList>
+#include <QList>
+#include <vector>
+
+namespace {
+
+// Above this many cells the LCS table is skipped and the whole changed block
+// counts as one change, which keeps huge rewrites cheap (and rarely mergeable)
+constexpr qint64 kMaxDiffCells = 4000000;
+
+// Base lines [start, end) replaced by 'lines'
+struct Hunk {
+    int start = 0;
+    int end = 0;
+    QStringList lines;
+
+    bool operator==(const Hunk &other) const
+    {
+        return start == other.start && end == other.end && lines == other.lines;
+    }
+};
+
+// The changes that turn 'base' into 'text', in base order: trims the common
+// head/tail, then runs an LCS over what is left
+QList<Hunk> changes(const QStringList &base, const QStringList &text)
+{
+    int head = 0;
+    while (head < base.size() && head < text.size() && base[head] == text[head])
+        ++head;
+    int tail = 0;
+    while (tail < base.size() - head && tail < text.size() - head
+           && base[base.size() - 1 - tail] == text[text.size() - 1 - tail])
+        ++tail;
+
+    QList<Hunk> hunks;
+    const int n = base.size() - head - tail;
+    const int m = text.size() - head - tail;
+    if (n == 0 && m == 0)
+        return hunks;
+    if (qint64(n + 1) * (m + 1) > kMaxDiffCells) {
+        hunks.append({head, head + n, text.mid(head, m)});
+        return hunks;
+    }
+
+    // lcs[i][j] = LCS length of base[head+i..] and text[head+j..]
+    std::vector<int> lcs(size_t(n + 1) * (m + 1), 0);
+    auto at = [&](int i, int j) -> int & { return lcs[size_t(i) * (m + 1) + j]; };
+    for (int i = n - 1; i >= 0; --i)
+        for (int j = m - 1; j >= 0; --j)
+            at(i, j) = base[head + i] == text[head + j]
+                ? at(i + 1, j + 1) + 1
+                : qMax(at(i + 1, j), at(i, j + 1));
+
+    Hunk hunk;
+    bool open = false;
+    int i = 0, j = 0;
+    while (i < n || j < m) {
+        if (i < n && j < m && base[head + i] == text[head + j]) {
+            if (open)
+                hunks.append(hunk);
+            open = false;
+            ++i; ++j;
+            continue;
+        }
+        if (!open) {
+            hunk = {head + i, head + i, QStringList()};
+            open = true;
+        }
+        if (i < n && (j >= m || at(i + 1, j) >= at(i, j + 1))) {
+            ++i; // Removed from the base
+            hunk.end = head + i;
+        } else {
+            hunk.lines.append(text[head + j++]);
+        }
+    }
+    if (open)
+        hunks.append(hunk);
+    return hunks;
+}
+
+// Changes that touch or overlap cannot be combined safely (as in diff3)
+bool clash(const Hunk &a, const Hunk &b)
+{
+    return a.start <= b.end && b.start <= a.end;
+}
+
+} // namespace
+
+namespace TextMerge
+{
+
+bool merge(const QString &base, const QString &ours, const QString &theirs, QString &out)
+{
+    out.clear();
+    if (ours == theirs || theirs == base) {
+        out = ours;
+        return true;
+    }
+    if (ours == base) {
+        out = theirs;
+        return true;
+    }
+
+    const QStringList baseLines = base.split(QLatin1Char('\n'));
+    const QList<Hunk> a = changes(baseLines, ours.split(QLatin1Char('\n')));
+    const QList<Hunk> b = changes(baseLines, theirs.split(QLatin1Char('\n')));
+
+    QStringList merged;
+    int position = 0; // Next base line not copied yet
+    auto take = [&](const Hunk &hunk) {
+        merged.append(baseLines.mid(position, hunk.start - position));
+        merged.append(hunk.lines);
+        position = hunk.end;
+    };
+    int ia = 0, ib = 0;
+    while (ia < a.size() || ib < b.size()) {
+        if (ia < a.size() && ib < b.size()) {
+            if (clash(a[ia], b[ib])) {
+                if (!(a[ia] == b[ib]))
+                    return false;
+                take(a[ia++]); // The same change on both sides
+                ++ib;
+            } else if (a[ia].start < b[ib].start) {
+                take(a[ia++]);
+            } else {
+                take(b[ib++]);
+            }
+        } else if (ia < a.size()) {
+            take(a[ia++]);
+        } else {
+            take(b[ib++]);
+        }
+    }
+    merged.append(baseLines.mid(position));
+    out = merged.join(QLatin1Char('\n'));
+    return true;
+}
+
+} // namespace TextMerge
@@ -0,0 +1,165 @@
+// src/TreeFilter.cpp
+#include "TreeFilter.h"
+
+#include <QTreeView>
+#include <QStandardItemModel>
+#include <QTimer>
+#include <QtAlgorithms> // qCountTrailingZeroBits
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NOTEAPP_FILTER_SSE2
+#include <emmintrin.h>
+#endif
+
+TreeFilter::TreeFilter(QTreeView *view, QStandardItemModel *model, QObject *parent)
+    : QObject(parent), view(view), model(model)
+{
+    reapplyTimer = new QTimer(this);
+    reapplyTimer->setSingleShot(true);
+    reapplyTimer->setInterval(0);
+    connect(reapplyTimer, &QTimer::timeout, this, &TreeFilter::apply);
+
+    // Any structural or title change invalidates the packed titles
+    connect(model, &QAbstractItemModel::rowsInserted, this, &TreeFilter::onModelChanged);
+    connect(model, &QAbstractItemModel::rowsRemoved, this, &TreeFilter::onModelChanged);
+    connect(model, &QAbstractItemModel::rowsMoved, this, &TreeFilter::onModelChanged);
+    connect(model, &QAbstractItemModel::modelReset, this, &TreeFilter::onModelChanged);
+    connect(model, &QAbstractItemModel::layoutChanged, this, &TreeFilter::onModelChanged);
+    connect(model, &QAbstractItemModel::dataChanged, this, &TreeFilter::onModelChanged);
+}
+
+void TreeFilter::setPattern(const QString &text)
+{
+    if (text == currentPattern) return;
+    currentPattern = text;
+    apply();
+}
+
+void TreeFilter::onModelChanged()
+{
+    dirty = true;
+    // New rows must be filtered too; wait for the burst of changes to end
+    if (!currentPattern.isEmpty())
+        reapplyTimer->start();
+}
+
+qsizetype TreeFilter::find(const ushort *haystack, qsizetype size, qsizetype from,
+                           const ushort *needle, qsizetype needleSize)
+{
+    if (needleSize == 0)
+        return from <= size ? from : -1;
+    if (from < 0 || needleSize > size - from)
+        return -1;
+
+    // Check the first and last needle unit at 8 positions at once; only
+    // positions where both agree get a full comparison
+    const ushort first = needle[0];
+    const ushort last = needle[needleSize - 1];
+    const qsizetype lastStart = size - needleSize;
+    qsizetype i = from;
+
+#ifdef NOTEAPP_FILTER_SSE2
+    const __m128i firstUnits = _mm_set1_epi16(short(first));
+    const __m128i lastUnits = _mm_set1_epi16(short(last));
+    for (; i + 7 <= lastStart; i += 8) {
+        const __m128i atFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+        const __m128i atLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i + needleSize - 1));
+        const __m128i hits = _mm_and_si128(_mm_cmpeq_epi16(atFirst, firstUnits), _mm_cmpeq_epi16(atLast, lastUnits));
+        quint32 mask = quint32(_mm_movemask_epi8(hits)); // Two bits per 16-bit lane
+        while (mask) {
+            const int lane = int(qCountTrailingZeroBits(mask)) / 2;
+            if (needleSize <= 2
+                || std::memcmp(haystack + i + lane + 1, needle + 1, size_t(needleSize - 2) * sizeof(ushort)) == 0)
+                return i + lane;
+            mask &= ~(3u << (lane * 2));
+        }
+    }
+#endif
+
+    // Scalar tail (and the whole scan without SSE2)
+    for (; i <= lastStart; ++i) {
+        if (haystack[i] == first && haystack[i + needleSize - 1] == last
+            && (needleSize <= 2
+                || std::memcmp(haystack + i + 1, needle + 1, size_t(needleSize - 2) * sizeof(ushort)) == 0))
+            return i;
+    }
+    return -1;
+}
+
+void TreeFilter::rebuild()
+{
+    titles.clear();
+    starts.clear();
+    parents.clear();
+    indexes.clear();
+    hidden.clear();
+
+    // Pre-order walk so that every parent comes before its children
+    struct Pending {
+        QModelIndex index;
+        int parent;
+    };
+    QVector<Pending> stack;
+    for (int row = model->rowCount() - 1; row >= 0; --row)
+        stack.append({model->index(row, 0), -1});
+
+    while (!stack.isEmpty()) {
+        const Pending pending = stack.takeLast();
+        const int node = indexes.size();
+
+        const QString folded = pending.index.data(Qt::DisplayRole).toString().toCaseFolded();
+        const qsizetype offset = titles.size();
+        starts.append(offset);
+        titles.resize(offset + folded.size() + 1);
+        std::memcpy(titles.data() + offset, folded.constData(), size_t(folded.size()) * sizeof(ushort));
+        titles[offset + folded.size()] = 0; // Keeps matches from spanning two titles
+
+        parents.append(pending.parent);
+        indexes.append(pending.index);
+        hidden.append(view->isRowHidden(pending.index.row(), pending.index.parent()));
+
+        for (int row = model->rowCount(pending.index) - 1; row >= 0; --row)
+            stack.append({model->index(row, 0, pending.index), node});
+    }
+    starts.append(titles.size()); // End sentinel
+    dirty = false;
+}
+
+void TreeFilter::apply()
+{
+    reapplyTimer->stop();
+    if (dirty)
+        rebuild();
+
+    const int count = indexes.size();
+    QVector<bool> visible(count, currentPattern.isEmpty());
+    if (!currentPattern.isEmpty()) {
+        const QString needle = currentPattern.toCaseFolded();
+        const ushort *needleUnits = reinterpret_cast<const ushort *>(needle.constData());
+        const ushort *haystack = titles.constData();
+
+        qsizetype pos = 0;
+        while ((pos = find(haystack, titles.size(), pos, needleUnits, needle.size())) >= 0) {
+            const int node = int(std::upper_bound(starts.cbegin(), starts.cend(), pos) - starts.cbegin()) - 1;
+            visible[node] = true;
+            pos = starts[node + 1]; // One hit per title is enough
+        }
+
+        // Children come after their parents, so one backwards pass reaches every ancestor
+        for (int node = count - 1; node >= 0; --node) {
+            if (visible[node] && parents[node] >= 0)
+                visible[parents[node]] = true;
+        }
+    }
+
+    // Only touch rows that change; expansion state is never modified
+    for (int node = 0; node < count; ++node) {
+        const bool hide = !visible[node];
+        if (hidden[node] != hide) {
+            view->setRowHidden(indexes[node].row(), indexes[node].parent(), hide);
+            hidden[node] = hide;
+        }
+    }
+}
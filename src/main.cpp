@@ -3,10 +3,49 @@
 #include <QFile> // Needed for loading the stylesheet
 #include <QTextStream> // Needed for reading the file
 #include <QStyleFactory> // Optional: For setting a base style
+#include <QCommandLineParser> // --library / --sync options
 #include "MainWindow.h"
+#include "LibrarySync.h"
+
+static void setApplicationInfo()
+{
+    QCoreApplication::setOrganizationName("YourCompanyName");
+    QCoreApplication::setApplicationName("NoteApp");
+    QCoreApplication::setApplicationVersion("0.1");
+}
+
+static void addOptions(QCommandLineParser &parser)
+{
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOption({"library", "Open the library in <dir> instead of the default one.", "dir"});
+    parser.addOption({"sync", "Sync the library with the one in <dir> and exit (no window).", "dir"});
+}
+
+// "NoteApp [--library A] --sync B" syncs two library folders without a GUI
+static int runSync(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    setApplicationInfo();
+    QCommandLineParser parser;
+    addOptions(parser);
+    parser.process(app);
+
+    const LibrarySync::Result result = LibrarySync::sync(
+        parser.isSet("library") ? parser.value("library") : LibrarySync::defaultLibraryPath(),
+        parser.value("sync"));
+    QTextStream(result.ok ? stdout : stderr) << result.summary() << Qt::endl;
+    return result.ok ? 0 : 1;
+}
 
 int main(int argc, char *argv[])
 {
+    // Decide before creating the application object: --sync must not need a display
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--sync") == 0 || qstrncmp(argv[i], "--sync=", 7) == 0)
+            return runSync(argc, argv);
+    }
+
     QApplication app(argc, argv);
     app.setStyle(QStyleFactory::create("Fusion"));
 
@@ -25,11 +64,12 @@ int main(int argc, char *argv[])
     // --- End Stylesheet ---
 
 
-    QCoreApplication::setOrganizationName("YourCompanyName");
-    QCoreApplication::setApplicationName("NoteApp");
-    QCoreApplication::setApplicationVersion("0.1");
+    setApplicationInfo();
+    QCommandLineParser parser;
+    addOptions(parser);
+    parser.process(app);
 
-    MainWindow mainWindow;
+    MainWindow mainWindow(parser.value("library"));
     mainWindow.show();
     return app.exec();
 }
\ No newline at end of file